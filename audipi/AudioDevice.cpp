@@ -1,20 +1,35 @@
 #include "AudioDevice.h"
 
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <alsa/asoundlib.h>
 
+#include "Trace.h"
+
 namespace audipi {
-    AudioDevice::AudioDevice() {
+    std::optional<latency_profile> find_latency_profile(const std::string_view name) {
+        for (const auto &profile: {DRIVER_LATENCY_PROFILE, LOW_LATENCY_PROFILE, BALANCED_LATENCY_PROFILE,
+                                   POWER_SAVE_LATENCY_PROFILE}) {
+            if (name == profile.name) {
+                return profile;
+            }
+        }
+        return std::nullopt;
+    }
+
+    AudioDevice::AudioDevice(const audio_device_config &config) {
         unsigned int channels = 2;
         unsigned int rate = 44100;
 
         this->pcm_handle = nullptr;
 
-        int error = snd_pcm_open(&this->pcm_handle, "default", SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK);
+        int error = snd_pcm_open(&this->pcm_handle, config.device_name.c_str(), SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK);
 
         if (error < 0) {
             printf("Failed to open PCM device %s\n", snd_strerror(error));
             this->pcm_handle = nullptr;
+            return;
         }
 
         snd_pcm_sw_params_t *sw_params = nullptr;
@@ -28,7 +43,12 @@ namespace audipi {
             return;
         }
 
-        if ((error = snd_pcm_hw_params_set_access(this->pcm_handle, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED)) < 0) {
+        if (config.use_mmap
+            && snd_pcm_hw_params_test_access(this->pcm_handle, hw_params, SND_PCM_ACCESS_MMAP_INTERLEAVED) == 0
+            && snd_pcm_hw_params_set_access(this->pcm_handle, hw_params, SND_PCM_ACCESS_MMAP_INTERLEAVED) == 0) {
+            this->mmap_access = true;
+        } else if ((error = snd_pcm_hw_params_set_access(this->pcm_handle, hw_params,
+                                                         SND_PCM_ACCESS_RW_INTERLEAVED)) < 0) {
             printf("ERROR: Can't set interleaved mode. %s\n", snd_strerror(error));
             this->pcm_handle = nullptr;
             return;
@@ -52,6 +72,22 @@ namespace audipi {
             return;
         }
 
+        const auto &profile = config.profile;
+
+        if (unsigned int buffer_time = profile.buffer_time_us; buffer_time > 0
+            && (error = snd_pcm_hw_params_set_buffer_time_near(this->pcm_handle, hw_params, &buffer_time, nullptr)) < 0) {
+            printf("ERROR: Can't set buffer time. %s\n", snd_strerror(error));
+            this->pcm_handle = nullptr;
+            return;
+        }
+
+        if (unsigned int period_time = profile.period_time_us; period_time > 0
+            && (error = snd_pcm_hw_params_set_period_time_near(this->pcm_handle, hw_params, &period_time, nullptr)) < 0) {
+            printf("ERROR: Can't set period time. %s\n", snd_strerror(error));
+            this->pcm_handle = nullptr;
+            return;
+        }
+
         if ((error = snd_pcm_hw_params(this->pcm_handle, hw_params)) < 0) {
             printf("Failed to set HW params: %s\n", snd_strerror(error));
             this->pcm_handle = nullptr;
@@ -64,15 +100,57 @@ namespace audipi {
             return;
         }
 
-        snd_pcm_sw_params_malloc(&sw_params);
+        if ((error = snd_pcm_hw_params_get_period_size(hw_params, &this->period_size, nullptr)) < 0) {
+            printf("Failed to get period size: %s\n", snd_strerror(error));
+            this->pcm_handle = nullptr;
+            return;
+        }
+
+        snd_pcm_sw_params_alloca(&sw_params);
         snd_pcm_sw_params_current(this->pcm_handle, sw_params);
 
+        // derived from what the driver actually granted, which may be far from what the profile asked for
+        this->avail_min = std::min(std::max(profile.avail_min_periods, 1u) * this->period_size, this->buffer_size);
+        if ((error = snd_pcm_sw_params_set_avail_min(this->pcm_handle, sw_params, this->avail_min)) < 0) {
+            printf("ERROR: Can't set avail min. %s\n", snd_strerror(error));
+            this->pcm_handle = nullptr;
+            return;
+        }
+
+        if (profile.start_threshold_periods > 0) {
+            const auto start_threshold = std::min(profile.start_threshold_periods * this->period_size,
+                                                  this->buffer_size);
+            if ((error = snd_pcm_sw_params_set_start_threshold(this->pcm_handle, sw_params, start_threshold)) < 0) {
+                printf("ERROR: Can't set start threshold. %s\n", snd_strerror(error));
+                this->pcm_handle = nullptr;
+                return;
+            }
+        }
+
+        // not worth failing over: without timestamps, statuses are stamped when read
+        if (snd_pcm_sw_params_set_tstamp_mode(this->pcm_handle, sw_params, SND_PCM_TSTAMP_ENABLE) == 0
+            && snd_pcm_sw_params_set_tstamp_type(this->pcm_handle, sw_params, SND_PCM_TSTAMP_TYPE_MONOTONIC) == 0) {
+            this->monotonic_timestamps = true;
+        }
+
+        if ((error = snd_pcm_sw_params(this->pcm_handle, sw_params)) < 0) {
+            printf("Failed to set SW params: %s\n", snd_strerror(error));
+            this->pcm_handle = nullptr;
+            return;
+        }
+
 #if AUDIPI_DEBUG
-        printf("Playback setup successful\n");
+        printf("Playback setup successful on %s (%s access, %s profile: buffer %lu, period %lu, avail min %lu)\n",
+               config.device_name.c_str(), this->mmap_access ? "mmap" : "read/write", profile.name,
+               this->buffer_size, this->period_size, this->avail_min);
 #endif
     }
 
     AudioDevice::~AudioDevice() {
+        // the device could not be opened
+        if (this->pcm_handle == nullptr) {
+            return;
+        }
         snd_pcm_drop(this->pcm_handle);
         snd_pcm_close(this->pcm_handle);
     }
@@ -81,52 +159,164 @@ namespace audipi {
         return this->pcm_handle != nullptr;
     }
 
-    std::expected<long, int> AudioDevice::enqueue_for_playback(const sample_data *buffer, const size_t size) const {
+    std::expected<long, int> AudioDevice::enqueue_for_playback(const sample_data *buffer, const size_t size) {
+        AUDIPI_TRACE_NAMED_SPAN(span, "AudioDevice::enqueue_for_playback");
+        AUDIPI_TRACE_SPAN_ARG(span, "samples", size);
+
         if (size == 0) {
             return 0;
         }
 
+        if (this->mmap_access) {
+            return this->enqueue_mmap(buffer, size);
+        }
+
         const auto written = snd_pcm_writei(this->pcm_handle, buffer, size);
         if (written == -EAGAIN) {
             return 0;
         }
         if (written < 0) {
-            if (int recover = snd_pcm_recover(this->pcm_handle, static_cast<int>(written), 0); recover < 0) {
+            if (int recover = this->recover(static_cast<int>(written), 0); recover < 0) {
                 return std::unexpected(recover);
             }
+            // recovered from an xrun: nothing was written, the next refill starts the stream again
+            return 0;
         }
         return written;
     }
 
-    void AudioDevice::prepare() const {
+    std::expected<long, int> AudioDevice::enqueue_mmap(const sample_data *buffer, const size_t size) const {
+        // mmap_begin only sees the space the last avail_update reported
+        if (const auto avail = snd_pcm_avail_update(this->pcm_handle); avail < 0) {
+            if (const int recover = this->recover(static_cast<int>(avail), 0); recover < 0) {
+                return std::unexpected(recover);
+            }
+            return 0;
+        }
+
+        const snd_pcm_channel_area_t *areas = nullptr;
+        snd_pcm_uframes_t offset = 0;
+        snd_pcm_uframes_t frames = size;
+
+        if (const int error = snd_pcm_mmap_begin(this->pcm_handle, &areas, &offset, &frames); error < 0) {
+            if (const int recover = this->recover(error, 0); recover < 0) {
+                return std::unexpected(recover);
+            }
+            return 0;
+        }
+
+        if (frames > 0) {
+            // interleaved: both channels share the first area, one sample_data per frame of the ring
+            auto *destination = static_cast<u_int8_t *>(areas[0].addr) + areas[0].first / 8 + offset * areas[0].step / 8;
+            std::memcpy(destination, buffer, frames * sizeof(sample_data));
+        }
+
+        const auto committed = snd_pcm_mmap_commit(this->pcm_handle, offset, frames);
+        if (committed < 0 || static_cast<snd_pcm_uframes_t>(committed) != frames) {
+            const int error = committed < 0 ? static_cast<int>(committed) : -EPIPE;
+            if (const int recover = this->recover(error, 0); recover < 0) {
+                return std::unexpected(recover);
+            }
+            return 0;
+        }
+
+        // unlike snd_pcm_writei, committing never starts the stream on its own
+        if (committed > 0 && snd_pcm_state(this->pcm_handle) == SND_PCM_STATE_PREPARED) {
+            snd_pcm_start(this->pcm_handle);
+        }
+
+        return committed;
+    }
+
+    int AudioDevice::recover(const int error, const int silent) const {
+        if (error == -EPIPE) {
+            AUDIPI_TRACE_INSTANT("AudioDevice::xrun");
+            if (this->metrics != nullptr) {
+                this->metrics->xruns.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        return snd_pcm_recover(this->pcm_handle, error, silent);
+    }
+
+    void AudioDevice::prepare() {
         snd_pcm_prepare(this->pcm_handle);
     }
 
-    void AudioDevice::pause() const {
+    void AudioDevice::pause() {
         if (snd_pcm_pause(this->pcm_handle, 1)) {
             printf("Error while pausing!");
         }
     }
 
-    void AudioDevice::resume() const {
+    void AudioDevice::resume() {
         snd_pcm_pause(this->pcm_handle, 0);
     }
 
-    void AudioDevice::reset() const {
+    void AudioDevice::reset() {
         snd_pcm_drop(this->pcm_handle);
         snd_pcm_prepare(this->pcm_handle);
     }
 
-    std::expected<unsigned long, long> AudioDevice::get_samples_in_buffer() const {
+    std::expected<bool, int> AudioDevice::wait_for_space(const int timeout_ms) {
+        AUDIPI_TRACE_SPAN("AudioDevice::wait_for_space");
+
+        const int ready = snd_pcm_wait(this->pcm_handle, timeout_ms);
+        if (ready < 0) {
+            if (const int recover = this->recover(ready, 1); recover < 0) {
+                return std::unexpected(recover);
+            }
+            return true;
+        }
+        return ready == 1;
+    }
+
+    std::expected<device_timestamp, int> AudioDevice::get_timestamp() {
+        snd_pcm_status_t *status = nullptr;
+        snd_pcm_status_alloca(&status);
+
+        if (const int error = snd_pcm_status(this->pcm_handle, status); error < 0) {
+            return std::unexpected(error);
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        const snd_pcm_state_t state = snd_pcm_status_get_state(status);
+        const snd_pcm_sframes_t delay = snd_pcm_status_get_delay(status);
+
+        device_timestamp timestamp{
+            static_cast<unsigned long>(std::max(delay, snd_pcm_sframes_t{0})), now,
+            state == SND_PCM_STATE_RUNNING || state == SND_PCM_STATE_DRAINING
+        };
+
+        if (this->monotonic_timestamps) {
+            snd_htimestamp_t htstamp{};
+            snd_pcm_status_get_htstamp(status, &htstamp);
+            const auto measured = std::chrono::steady_clock::time_point(
+                std::chrono::seconds(htstamp.tv_sec) + std::chrono::nanoseconds(htstamp.tv_nsec));
+            // some plugins leave it at zero; a stamp from the future would be just as wrong
+            if (htstamp.tv_sec != 0 && measured <= now) {
+                timestamp.time = measured;
+            }
+        }
+        return timestamp;
+    }
+
+    std::expected<unsigned long, long> AudioDevice::get_available_samples() {
         snd_pcm_sframes_t pcm_avail_update = snd_pcm_avail_update(this->pcm_handle);
         if (pcm_avail_update < 0) {
-            return std::unexpected(pcm_avail_update);
+            if (const int recover = this->recover(static_cast<int>(pcm_avail_update), 1);
+                recover < 0) {
+                return std::unexpected(pcm_avail_update);
+            }
+            pcm_avail_update = snd_pcm_avail_update(this->pcm_handle);
+            if (pcm_avail_update < 0) {
+                return std::unexpected(pcm_avail_update);
+            }
         }
 
-        return this->buffer_size - pcm_avail_update;
+        return pcm_avail_update;
     }
 
-    std::string AudioDevice::render_error(const int error_code) {
+    std::string AudioDevice::render_error(const int error_code) const {
         return snd_strerror(error_code);
     }
 }
@@ -2,38 +2,99 @@
 #define AUDIODEVICE_H
 
 #include <expected>
+#include <optional>
 #include <string>
+#include <string_view>
 
-#include "structs.h"
+#include "AudioSink.h"
 
 // Forward declaration of the ALSA types, expected to be present at link time
 using snd_pcm_t = struct _snd_pcm; // NOLINT(*-reserved-identifier)
 using snd_timestamp_t = timeval;
 
 namespace audipi {
-    class AudioDevice {
+    /**
+    * @brief Buffer and period sizing for the audio device, trading latency of the controls for wakeups.
+    * Times of 0 leave the choice to the driver.
+    */
+    struct latency_profile {
+        const char *name;
+        unsigned int buffer_time_us;
+        unsigned int period_time_us;
+        unsigned int avail_min_periods; // wake the output thread up once this many periods can be refilled
+        unsigned int start_threshold_periods; // start playing once this many periods are queued, 0 for the default
+    };
+
+    constexpr latency_profile DRIVER_LATENCY_PROFILE = {"driver", 0, 0, 1, 0};
+    constexpr latency_profile LOW_LATENCY_PROFILE = {"low-latency", 40000, 10000, 1, 1};
+    constexpr latency_profile BALANCED_LATENCY_PROFILE = {"balanced", 200000, 50000, 1, 2};
+    constexpr latency_profile POWER_SAVE_LATENCY_PROFILE = {"power-save", 2000000, 500000, 2, 2};
+
+    /**
+    * @brief Looks a profile up by its name ("driver", "low-latency", "balanced" or "power-save").
+    */
+    [[nodiscard]] std::optional<latency_profile> find_latency_profile(std::string_view name);
+
+    struct audio_device_config {
+        std::string device_name = "default"; // any ALSA PCM, e.g. "null" or a file plugin to run without a sound card
+        latency_profile profile = DRIVER_LATENCY_PROFILE;
+        // write straight into the device's ring buffer with snd_pcm_mmap_begin/commit instead of snd_pcm_writei,
+        // falling back to the latter if the device does not support it
+        bool use_mmap = false;
+    };
+
+    /**
+    * @brief The ALSA sink: plays through a PCM device, "default" unless configured otherwise.
+    */
+    class AudioDevice final : public AudioSink {
         snd_pcm_t *pcm_handle;
-        unsigned long buffer_size{};
+        bool mmap_access = false;
+        bool monotonic_timestamps = false; // the driver stamps statuses on CLOCK_MONOTONIC, as steady_clock runs
+
+        // snd_pcm_recover, counting underruns
+        int recover(int error, int silent) const;
+
+        [[nodiscard]] std::expected<long, int> enqueue_mmap(const sample_data *buffer, std::size_t size) const;
 
     public:
-        AudioDevice();
-        ~AudioDevice();
+        explicit AudioDevice(const audio_device_config &config = {});
+        ~AudioDevice() override;
+
+        [[nodiscard]] bool is_init() const override;
+
+        [[nodiscard]] std::expected<long, int> enqueue_for_playback(const sample_data *buffer,
+                                                                    std::size_t size) override;
+
+        void prepare() override;
 
-        [[nodiscard]] bool is_init() const;
+        void pause() override;
 
-        [[nodiscard]] std::expected<long, int> enqueue_for_playback(const sample_data *buffer, std::size_t size) const;
+        void resume() override;
 
-        void prepare() const;
+        void reset() override;
 
-        void pause() const;
+        /**
+        * @brief Blocks until the device can take at least avail_min samples, as negotiated from the profile, or
+        * timeout_ms elapses. Recovers from underruns on the way; returns false on timeout.
+        */
+        [[nodiscard]] std::expected<bool, int> wait_for_space(int timeout_ms) override;
 
-        void resume() const;
+        /**
+        * @brief Delay of the device, stamped by the driver when it measured it (snd_pcm_status) rather than when the
+        * call returns, if it can.
+        */
+        [[nodiscard]] std::expected<device_timestamp, int> get_timestamp() override;
 
-        void reset() const;
+        [[nodiscard]] std::expected<unsigned long, long> get_available_samples() override;
 
-        [[nodiscard]] std::expected<unsigned long, long> get_samples_in_buffer() const;
+        /**
+        * @brief Whether samples are written through the mmap interface (requested and supported by the device).
+        */
+        [[nodiscard]] bool is_mmap() const {
+            return mmap_access;
+        }
 
-        [[nodiscard]] static std::string render_error(int error_code);
+        [[nodiscard]] std::string render_error(int error_code) const override;
     };
 }
 
@@ -0,0 +1,61 @@
+#include "AudioSink.h"
+
+#include <cstring>
+
+#include "AudioDevice.h"
+#include "FileSink.h"
+#include "NullSink.h"
+
+namespace audipi {
+    std::string AudioSink::render_error(const int error_code) const {
+        return strerror(-error_code);
+    }
+
+    std::expected<std::unique_ptr<AudioSink>, std::string> make_audio_sink(const std::string_view spec) {
+        const auto separator = spec.find(':');
+        const std::string_view kind = spec.substr(0, separator);
+        const std::string argument(separator == std::string_view::npos ? "" : spec.substr(separator + 1));
+
+        if (kind == "alsa") {
+            audio_device_config config;
+            if (!argument.empty()) {
+                config.device_name = argument;
+            }
+            auto device = std::make_unique<AudioDevice>(config);
+            if (!device->is_init()) {
+                return std::unexpected("Cannot open ALSA device " + config.device_name);
+            }
+            return device;
+        }
+
+        if (kind == "null") {
+            if (!argument.empty() && argument != "realtime") {
+                return std::unexpected("Unknown null sink mode " + argument + ", expected realtime");
+            }
+            return std::make_unique<NullSink>(argument == "realtime");
+        }
+
+        if ((kind == "pcm" || kind == "wav") && argument.empty()) {
+            return std::unexpected(std::string(kind) + " sink needs a path, as in " + std::string(kind) + ":<path>");
+        }
+
+        if (kind == "pcm") {
+            auto sink = PcmFileSink::open(argument);
+            if (!sink) {
+                return std::unexpected("Cannot open " + argument + ": " + strerror(sink.error()));
+            }
+            return std::move(sink.value());
+        }
+
+        if (kind == "wav") {
+            auto sink = WavFileSink::open(argument);
+            if (!sink) {
+                return std::unexpected("Cannot open " + argument + ": " + strerror(sink.error()));
+            }
+            return std::move(sink.value());
+        }
+
+        return std::unexpected("Unknown audio sink " + std::string(spec)
+                               + ", expected alsa[:<device>], null[:realtime], pcm:<path> or wav:<path>");
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef AUDIOSINK_H
+#define AUDIOSINK_H
+
+#include <chrono>
+#include <expected>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "PlayerMetrics.h"
+#include "structs.h"
+
+namespace audipi {
+    /**
+    * @brief How much of what was written the sink has yet to play, and when that was measured.
+    */
+    struct device_timestamp {
+        unsigned long delay; // samples until the next one written is heard, including codec and DAC delay
+        std::chrono::steady_clock::time_point time;
+        bool running; // whether the sink was playing, so that the delay shrinks as time goes by
+    };
+
+    /**
+    * @brief Where the player's samples go: 44.1 kHz 16-bit stereo, into a buffer of get_buffer_size() samples that
+    * the sink plays out on its own, the way an ALSA device does.
+    * Errors are negative errno values, ALSA error codes for AudioDevice; render_error() turns either into text.
+    */
+    class AudioSink {
+    protected:
+        unsigned long buffer_size{};
+        unsigned long period_size{};
+        unsigned long avail_min{};
+        PlayerMetrics *metrics = nullptr;
+
+    public:
+        AudioSink() = default;
+        virtual ~AudioSink() = default;
+
+        AudioSink(const AudioSink &) = delete;
+        AudioSink &operator=(const AudioSink &) = delete;
+
+        [[nodiscard]] virtual bool is_init() const = 0;
+
+        void set_metrics(PlayerMetrics *metrics) {
+            this->metrics = metrics;
+        }
+
+        /**
+        * @brief Writes up to size samples without blocking for long, returns how many were taken.
+        */
+        [[nodiscard]] virtual std::expected<long, int> enqueue_for_playback(const sample_data *buffer,
+                                                                            std::size_t size) = 0;
+
+        virtual void prepare() = 0;
+
+        virtual void pause() = 0;
+
+        virtual void resume() = 0;
+
+        /**
+        * @brief Drops whatever was written and not played yet, where the sink can.
+        */
+        virtual void reset() = 0;
+
+        /**
+        * @brief Blocks until the sink can take at least get_avail_min() samples, or timeout_ms elapses.
+        * Returns false on timeout.
+        */
+        [[nodiscard]] virtual std::expected<bool, int> wait_for_space(int timeout_ms) = 0;
+
+        [[nodiscard]] virtual std::expected<unsigned long, long> get_available_samples() = 0;
+
+        [[nodiscard]] virtual std::expected<device_timestamp, int> get_timestamp() = 0;
+
+        [[nodiscard]] virtual std::string render_error(int error_code) const;
+
+        [[nodiscard]] unsigned long get_buffer_size() const {
+            return buffer_size;
+        }
+
+        [[nodiscard]] unsigned long get_period_size() const {
+            return period_size;
+        }
+
+        /**
+        * @brief Free space the sink waits for before waking the output thread up.
+        * Refilling with less than this is not worth a wakeup.
+        */
+        [[nodiscard]] unsigned long get_avail_min() const {
+            return avail_min;
+        }
+    };
+
+    /**
+    * @brief Creates the sink described by spec:
+    * - "alsa" or "alsa:<device>": an ALSA PCM, "default" if not given
+    * - "null": takes samples as fast as they come
+    * - "null:realtime": plays them out at 44.1 kHz, like a sound card would
+    * - "pcm:<path>": raw samples written to a file or a pipe, e.g. a FIFO another program reads from
+    * - "wav:<path>": a WAV file
+    */
+    [[nodiscard]] std::expected<std::unique_ptr<AudioSink>, std::string> make_audio_sink(std::string_view spec);
+}
+
+#endif //AUDIOSINK_H
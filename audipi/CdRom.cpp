@@ -1,10 +1,14 @@
 #include "CdRom.h"
 
+#include <cerrno>
+#include <cstring>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <linux/cdrom.h>
 
+#include "Trace.h"
+
 constexpr __u8 CD_TIME_FORMAT = CDROM_MSF;
 
 audipi::msf_location cdrom_addr_to_msf_location(const cdrom_addr &addr) {
@@ -26,6 +30,9 @@ cdrom_addr msf_location_to_cdrom_addr(const audipi::msf_location &location) {
 }
 
 namespace audipi {
+    CdRom::CdRom() : cdrom_fd(-1) {
+    }
+
     CdRom::CdRom(const std::string &fd_path) {
         this->cdrom_fd = open(fd_path.c_str(), O_RDONLY | O_NONBLOCK);
     }
@@ -41,6 +48,13 @@ namespace audipi {
         return {};
     }
 
+    std::expected<void, int> CdRom::select_speed(const unsigned int speed) const {
+        if (ioctl(cdrom_fd, CDROM_SELECT_SPEED, speed)) {
+            return std::unexpected(errno);
+        }
+        return {};
+    }
+
     std::expected<void, int> CdRom::stop() const {
         if (ioctl(cdrom_fd, CDROMSTOP, 0)) {
             return std::unexpected(errno);
@@ -71,8 +85,8 @@ namespace audipi {
     }
 
     std::expected<void, int> CdRom::close_tray() const {
-        if (int error = ioctl(cdrom_fd, CDROMCLOSETRAY, 0)) {
-            return std::unexpected(error);
+        if (ioctl(cdrom_fd, CDROMCLOSETRAY, 0)) {
+            return std::unexpected(errno);
         }
 
         return {};
@@ -101,8 +115,8 @@ namespace audipi {
     std::expected<disk_toc, int> CdRom::read_toc() const {
         cdrom_tochdr header{};
 
-        if (int header_error = ioctl(cdrom_fd, CDROMREADTOCHDR, &header)) {
-            return std::unexpected(header_error);
+        if (ioctl(cdrom_fd, CDROMREADTOCHDR, &header)) {
+            return std::unexpected(errno);
         }
 
         std::vector<disk_toc_entry> entries;
@@ -115,8 +129,8 @@ namespace audipi {
         for (auto track = header.cdth_trk0; track <= header.cdth_trk1; ++track) {
             entry.cdte_track = track;
 
-            if (const int entry_error = ioctl(cdrom_fd, CDROMREADTOCENTRY, &entry)) {
-                return std::unexpected(entry_error);
+            if (ioctl(cdrom_fd, CDROMREADTOCENTRY, &entry)) {
+                return std::unexpected(errno);
             }
 
             const auto current_msf = cdrom_addr_to_msf_location(entry.cdte_addr);
@@ -146,39 +160,81 @@ namespace audipi {
         return disk_toc{header.cdth_trk0, header.cdth_trk1, entries};
     }
 
-    std::expected<cd_audio_frame, int> CdRom::read_frame(const msf_location &location) const {
+    std::expected<cd_audio_frame, int> CdRom::read_frame(const msf_location &location,
+                                                         const subchannel_mode mode) const {
+        cd_audio_frame frame{};
 
-        u_int8_t buffer[2352]{};
+        if (auto result = read_frames(location, 1, frame.raw_data.data()); !result) {
+            return std::unexpected(result.error());
+        }
 
-        cdrom_read_audio audio_read{
-            .addr = msf_location_to_cdrom_addr(location),
-            .addr_format = CD_TIME_FORMAT,
-            .nframes = 1,
-            .buf = buffer
-        };
+        if (mode == subchannel_mode::none) {
+            return frame;
+        }
 
-        if (int read_error = ioctl(cdrom_fd, CDROMREADAUDIO, &audio_read)) {
-            return std::unexpected(read_error);
+        const auto subchannel = read_subchannel();
+        if (!subchannel) {
+            return std::unexpected(subchannel.error());
         }
 
-        cd_audio_frame frame{};
+        frame.track_num = subchannel->track_num;
+        frame.index_num = subchannel->index_num;
+        frame.location_abs = subchannel->location_abs;
+        frame.location_rel = subchannel->location_rel;
+
+        return frame;
+    }
 
-        frame.raw_data = std::to_array(buffer);
+    std::expected<subchannel_position, int> CdRom::read_subchannel() const {
+        AUDIPI_TRACE_SPAN("CdRom::read_subchannel");
 
         cdrom_subchnl audio_subchannel{
             .cdsc_format = CDROM_MSF,
         };
 
-        if (int read_error = ioctl(cdrom_fd, CDROMSUBCHNL, &audio_subchannel)) {
-            return std::unexpected(read_error);
+        if (ioctl(cdrom_fd, CDROMSUBCHNL, &audio_subchannel)) {
+            return std::unexpected(errno);
         }
 
-        frame.track_num = audio_subchannel.cdsc_trk;
-        frame.index_num = audio_subchannel.cdsc_ind;
-        frame.location_abs = cdrom_addr_to_msf_location(audio_subchannel.cdsc_absaddr);
-        frame.location_rel = cdrom_addr_to_msf_location(audio_subchannel.cdsc_reladdr);
+        return subchannel_position{
+            audio_subchannel.cdsc_trk,
+            audio_subchannel.cdsc_ind,
+            cdrom_addr_to_msf_location(audio_subchannel.cdsc_absaddr),
+            cdrom_addr_to_msf_location(audio_subchannel.cdsc_reladdr)
+        };
+    }
+
+    std::expected<void, int> CdRom::read_frames(const msf_location &location, const size_t nframes,
+                                                u_int8_t *buffer) const {
+        AUDIPI_TRACE_NAMED_SPAN(span, "CdRom::read_frames");
+        AUDIPI_TRACE_SPAN_ARG(span, "frames", nframes);
 
-        return frame;
+        if (nframes == 0 || nframes > MAX_READ_FRAMES) {
+            return std::unexpected(EINVAL);
+        }
+
+        cdrom_read_audio audio_read{
+            .addr = msf_location_to_cdrom_addr(location),
+            .addr_format = CD_TIME_FORMAT,
+            .nframes = static_cast<int>(nframes),
+            .buf = buffer
+        };
+
+        // errno, not the ioctl's -1: callers tell a pulled disc (ENOMEDIUM) from a bad sector (EIO) by it
+        if (ioctl(cdrom_fd, CDROMREADAUDIO, &audio_read)) {
+            return std::unexpected(errno);
+        }
+
+        return {};
+    }
+
+    std::expected<void, int> CdRom::read_frames_c2(const msf_location &location, const size_t nframes,
+                                                   u_int8_t *buffer, u_int8_t *c2_pointers) const {
+        if (auto result = read_frames(location, nframes, buffer); !result) {
+            return result;
+        }
+        std::memset(c2_pointers, 0, nframes * CD_C2_BYTES);
+        return {};
     }
 
     CdRom::~CdRom() {
@@ -8,10 +8,30 @@
 #include "structs.h"
 
 namespace audipi {
+    // the kernel refuses CDROMREADAUDIO requests longer than a second of audio
+    constexpr size_t MAX_READ_FRAMES = CD_FRAMES;
+    // C2 error pointers of a frame, one bit per byte of audio, set where the drive could not correct it
+    constexpr size_t CD_C2_BYTES = CD_FRAMESIZE_RAW / 8;
+
+    /**
+    * @brief Whether C2 pointers flag any byte of the given stereo sample, counted from the first frame they cover.
+    */
+    [[nodiscard]] inline bool is_sample_damaged(const u_int8_t *c2_pointers, const size_t sample) {
+        // most significant bit first, 4 bytes per sample: even samples are the high nibble, odd ones the low one
+        return (c2_pointers[sample / 2] & (sample % 2 == 0 ? 0xF0 : 0x0F)) != 0;
+    }
 
     class CdRom {
         int cdrom_fd;
 
+    protected:
+        // for drives that do not sit behind a device node (e.g. simulated drives)
+        CdRom();
+
+        [[nodiscard]] int get_fd() const {
+            return cdrom_fd;
+        }
+
     public:
         explicit CdRom(const std::string &fd_path);
 
@@ -28,9 +48,39 @@ namespace audipi {
 
         [[nodiscard]] std::expected<disk_toc, int> read_toc() const;
 
-        [[nodiscard]] std::expected<cd_audio_frame, int> read_frame(const msf_location& location) const;
+        /**
+        * @brief Sets the spin speed for reads, in multiples of 1x (75 frames per second); 0 for the fastest.
+        * Drives round it to a speed they support.
+        */
+        [[nodiscard]] virtual std::expected<void, int> select_speed(unsigned int speed) const;
+
+        /**
+        * @brief Reads a single frame. Its subchannel fields are only filled in (with CDROMSUBCHNL, right after the
+        * read) unless mode is subchannel_mode::none; they are zero otherwise.
+        */
+        [[nodiscard]] std::expected<cd_audio_frame, int> read_frame(
+            const msf_location& location, subchannel_mode mode = subchannel_mode::per_frame) const;
+
+        /**
+        * @brief Polls the Q subchannel: the track, index and position the drive last read.
+        */
+        [[nodiscard]] virtual std::expected<subchannel_position, int> read_subchannel() const;
+
+        /**
+        * @brief Reads nframes contiguous raw audio frames starting at location with a single CDROMREADAUDIO.
+        * buffer must hold at least nframes * CD_FRAMESIZE_RAW bytes; nframes is limited to MAX_READ_FRAMES.
+        */
+        [[nodiscard]] virtual std::expected<void, int> read_frames(const msf_location& location, size_t nframes,
+                                                                   u_int8_t *buffer) const;
+
+        /**
+        * @brief Reads like read_frames(), and fills c2_pointers with CD_C2_BYTES of C2 error pointers per frame.
+        * Drives that cannot report them, CDROMREADAUDIO included, leave them all clear.
+        */
+        [[nodiscard]] virtual std::expected<void, int> read_frames_c2(const msf_location& location, size_t nframes,
+                                                                      u_int8_t *buffer, u_int8_t *c2_pointers) const;
 
-        ~CdRom();
+        virtual ~CdRom();
     };
 } // audipi
 
@@ -0,0 +1,186 @@
+#include "FileSink.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+
+#include "PlaybackClock.h"
+#include "Trace.h"
+
+constexpr size_t WAV_HEADER_BYTES = 44;
+// offsets in the header of the sizes only known once the file is complete
+constexpr off_t WAV_RIFF_SIZE_OFFSET = 4;
+constexpr off_t WAV_DATA_SIZE_OFFSET = 40;
+
+namespace {
+    void write_le16(u_int8_t *data, const u_int16_t value) {
+        data[0] = static_cast<u_int8_t>(value);
+        data[1] = static_cast<u_int8_t>(value >> 8);
+    }
+
+    void write_le32(u_int8_t *data, const u_int32_t value) {
+        write_le16(data, static_cast<u_int16_t>(value));
+        write_le16(data + 2, static_cast<u_int16_t>(value >> 16));
+    }
+
+    // all of size bytes, unless an error comes first
+    std::expected<void, int> write_all(const int fd, const u_int8_t *data, size_t size) {
+        while (size > 0) {
+            const ssize_t written = ::write(fd, data, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return std::unexpected(errno);
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+        return {};
+    }
+
+    std::array<u_int8_t, WAV_HEADER_BYTES> make_wav_header(const size_t data_bytes) {
+        // a RIFF file cannot tell more than 4 GiB, players read on regardless
+        const auto data_size = static_cast<u_int32_t>(std::min<size_t>(data_bytes, UINT32_MAX - WAV_HEADER_BYTES));
+        constexpr u_int16_t channels = 2;
+        constexpr u_int16_t bits = 16;
+        constexpr auto block_align = static_cast<u_int16_t>(channels * bits / 8);
+
+        std::array<u_int8_t, WAV_HEADER_BYTES> header{};
+        std::memcpy(header.data(), "RIFF", 4);
+        write_le32(header.data() + 4, static_cast<u_int32_t>(data_size + WAV_HEADER_BYTES - 8));
+        std::memcpy(header.data() + 8, "WAVEfmt ", 8);
+        write_le32(header.data() + 16, 16);
+        write_le16(header.data() + 20, 1); // PCM
+        write_le16(header.data() + 22, channels);
+        write_le32(header.data() + 24, audipi::SAMPLE_RATE);
+        write_le32(header.data() + 28, audipi::SAMPLE_RATE * block_align);
+        write_le16(header.data() + 32, block_align);
+        write_le16(header.data() + 34, bits);
+        std::memcpy(header.data() + 36, "data", 4);
+        write_le32(header.data() + 40, data_size);
+        return header;
+    }
+}
+
+namespace audipi {
+    PcmFileSink::PcmFileSink(const int fd, const bool owns_fd) : fd(fd), owns_fd(owns_fd) {
+        this->buffer_size = FILE_SINK_BUFFER_SAMPLES;
+        this->period_size = FILE_SINK_PERIOD_SAMPLES;
+
+        struct stat st{};
+        if (fd >= 0 && fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode)) {
+            if (const int pipe_size = fcntl(fd, F_GETPIPE_SZ); pipe_size > 0) {
+                this->is_pipe = true;
+                this->buffer_size = static_cast<unsigned long>(pipe_size) / sizeof(sample_data);
+                this->period_size = this->buffer_size / 4;
+            }
+        }
+        this->avail_min = this->period_size;
+    }
+
+    PcmFileSink::~PcmFileSink() {
+        if (this->owns_fd && this->fd >= 0) {
+            close(this->fd);
+        }
+    }
+
+    std::expected<std::unique_ptr<PcmFileSink>, int> PcmFileSink::open(const std::string &path) {
+        const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            return std::unexpected(errno);
+        }
+        return std::make_unique<PcmFileSink>(fd, true);
+    }
+
+    std::expected<unsigned long, int> PcmFileSink::get_unread_bytes() const {
+        if (!this->is_pipe) {
+            return 0;
+        }
+        int unread = 0;
+        if (ioctl(this->fd, FIONREAD, &unread) < 0) {
+            return std::unexpected(errno);
+        }
+        return static_cast<unsigned long>(unread);
+    }
+
+    std::expected<long, int> PcmFileSink::enqueue_for_playback(const sample_data *buffer, const size_t size) {
+        AUDIPI_TRACE_NAMED_SPAN(span, "PcmFileSink::enqueue_for_playback");
+        AUDIPI_TRACE_SPAN_ARG(span, "samples", size);
+
+        const auto bytes = size * sizeof(sample_data);
+        if (const auto result = write_all(this->fd, buffer->data, bytes); !result) {
+            return std::unexpected(-result.error());
+        }
+        this->written_bytes += bytes;
+        return static_cast<long>(size);
+    }
+
+    std::expected<bool, int> PcmFileSink::wait_for_space(const int timeout_ms) {
+        AUDIPI_TRACE_SPAN("PcmFileSink::wait_for_space");
+
+        if (!this->is_pipe) {
+            return true;
+        }
+        pollfd poll_fd{this->fd, POLLOUT, 0};
+        const int ready = poll(&poll_fd, 1, timeout_ms);
+        if (ready < 0 && errno != EINTR) {
+            return std::unexpected(-errno);
+        }
+        // on POLLERR, the reader is gone: let the next write report it
+        return ready == 1;
+    }
+
+    std::expected<unsigned long, long> PcmFileSink::get_available_samples() {
+        const auto unread = this->get_unread_bytes();
+        if (!unread) {
+            return std::unexpected(-unread.error());
+        }
+        const unsigned long queued = unread.value() / sizeof(sample_data);
+        return this->buffer_size - std::min(queued, this->buffer_size);
+    }
+
+    std::expected<device_timestamp, int> PcmFileSink::get_timestamp() {
+        const auto unread = this->get_unread_bytes();
+        if (!unread) {
+            return std::unexpected(-unread.error());
+        }
+        const unsigned long delay = unread.value() / sizeof(sample_data);
+        return device_timestamp{delay, std::chrono::steady_clock::now(), delay > 0};
+    }
+
+    WavFileSink::WavFileSink(const int fd) : PcmFileSink(fd, true) {
+    }
+
+    WavFileSink::~WavFileSink() {
+        if (this->fd < 0) {
+            return;
+        }
+        const auto header = make_wav_header(this->written_bytes);
+        // best effort: a header left with zero sizes still plays in most players
+        [[maybe_unused]] const auto riff = pwrite(this->fd, header.data() + WAV_RIFF_SIZE_OFFSET, 4,
+                                                  WAV_RIFF_SIZE_OFFSET);
+        [[maybe_unused]] const auto data = pwrite(this->fd, header.data() + WAV_DATA_SIZE_OFFSET, 4,
+                                                  WAV_DATA_SIZE_OFFSET);
+    }
+
+    std::expected<std::unique_ptr<WavFileSink>, int> WavFileSink::open(const std::string &path) {
+        const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            return std::unexpected(errno);
+        }
+
+        const auto header = make_wav_header(0);
+        if (const auto result = write_all(fd, header.data(), header.size()); !result) {
+            close(fd);
+            return std::unexpected(result.error());
+        }
+        return std::unique_ptr<WavFileSink>(new WavFileSink(fd));
+    }
+}
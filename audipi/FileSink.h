@@ -0,0 +1,82 @@
+#ifndef FILESINK_H
+#define FILESINK_H
+
+#include <expected>
+#include <memory>
+#include <string>
+
+#include "AudioSink.h"
+
+namespace audipi {
+    // buffer of a sink writing to a regular file, which takes whatever it is given right away
+    constexpr unsigned long FILE_SINK_BUFFER_SAMPLES = 8820;
+    constexpr unsigned long FILE_SINK_PERIOD_SAMPLES = 2205;
+
+    /**
+    * @brief Writes the raw samples (s16le, stereo, 44.1 kHz) to a file descriptor. On a pipe, the sink's buffer is
+    * the pipe's, so that playback is paced by whoever reads it and the position follows what they have read.
+    * Writing to a pipe nobody reads fails with EPIPE, as long as SIGPIPE is ignored.
+    */
+    class PcmFileSink : public AudioSink {
+    protected:
+        int fd;
+        bool owns_fd;
+        bool is_pipe = false;
+        size_t written_bytes = 0;
+
+        // bytes written to the pipe and not read yet
+        [[nodiscard]] std::expected<unsigned long, int> get_unread_bytes() const;
+
+    public:
+        /**
+        * @brief Writes to fd, left open on destruction unless owns_fd.
+        */
+        explicit PcmFileSink(int fd, bool owns_fd = false);
+        ~PcmFileSink() override;
+
+        /**
+        * @brief Opens path for writing, truncating a regular file. Opening a FIFO waits for a reader.
+        */
+        [[nodiscard]] static std::expected<std::unique_ptr<PcmFileSink>, int> open(const std::string &path);
+
+        [[nodiscard]] bool is_init() const override {
+            return fd >= 0;
+        }
+
+        [[nodiscard]] std::expected<long, int> enqueue_for_playback(const sample_data *buffer,
+                                                                    std::size_t size) override;
+
+        // what was written cannot be taken back or held: these do nothing
+        void prepare() override {
+        }
+
+        void pause() override {
+        }
+
+        void resume() override {
+        }
+
+        void reset() override {
+        }
+
+        [[nodiscard]] std::expected<bool, int> wait_for_space(int timeout_ms) override;
+
+        [[nodiscard]] std::expected<unsigned long, long> get_available_samples() override;
+
+        [[nodiscard]] std::expected<device_timestamp, int> get_timestamp() override;
+    };
+
+    /**
+    * @brief Writes the samples to a WAV file. The sizes in the header are filled in when the sink is destroyed.
+    */
+    class WavFileSink final : public PcmFileSink {
+        explicit WavFileSink(int fd);
+
+    public:
+        ~WavFileSink() override;
+
+        [[nodiscard]] static std::expected<std::unique_ptr<WavFileSink>, int> open(const std::string &path);
+    };
+}
+
+#endif //FILESINK_H
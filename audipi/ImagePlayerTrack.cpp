@@ -0,0 +1,270 @@
+#include "ImagePlayerTrack.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <linux/cdrom.h>
+
+#include "util.h"
+
+namespace {
+    struct wav_data {
+        size_t offset;
+        size_t size;
+    };
+
+    u_int16_t read_le16(const u_int8_t *data) {
+        return static_cast<u_int16_t>(data[0] | data[1] << 8);
+    }
+
+    u_int32_t read_le32(const u_int8_t *data) {
+        return static_cast<u_int32_t>(data[0]) | static_cast<u_int32_t>(data[1]) << 8
+               | static_cast<u_int32_t>(data[2]) << 16 | static_cast<u_int32_t>(data[3]) << 24;
+    }
+
+    std::expected<wav_data, std::string> find_wav_data(const audipi::MappedFile &file) {
+        const u_int8_t *data = file.get_data();
+        const size_t size = file.get_size();
+
+        if (size < 12 || std::memcmp(data, "RIFF", 4) != 0 || std::memcmp(data + 8, "WAVE", 4) != 0) {
+            return std::unexpected("Not a RIFF/WAVE file");
+        }
+
+        bool format_ok = false;
+        size_t offset = 12;
+
+        while (offset + 8 <= size) {
+            const u_int8_t *chunk = data + offset;
+            const size_t chunk_size = read_le32(chunk + 4);
+            const size_t body = offset + 8;
+
+            if (std::memcmp(chunk, "fmt ", 4) == 0) {
+                if (chunk_size < 16 || body + 16 > size) {
+                    return std::unexpected("Truncated fmt chunk");
+                }
+                const u_int16_t format = read_le16(data + body);
+                const u_int16_t channels = read_le16(data + body + 2);
+                const u_int32_t rate = read_le32(data + body + 4);
+                const u_int16_t bits = read_le16(data + body + 14);
+                if (format != 1 || channels != 2 || rate != 44100 || bits != 16) {
+                    return std::unexpected("Only 16-bit stereo 44.1 kHz PCM is supported");
+                }
+                format_ok = true;
+            } else if (std::memcmp(chunk, "data", 4) == 0) {
+                if (!format_ok) {
+                    return std::unexpected("data chunk before fmt chunk");
+                }
+                return wav_data{body, std::min(chunk_size, size - body)};
+            }
+
+            // chunks are padded to an even size
+            offset = body + chunk_size + (chunk_size & 1);
+        }
+
+        return std::unexpected("No data chunk");
+    }
+
+    struct cue_file {
+        std::shared_ptr<audipi::MappedFile> file;
+        size_t data_offset;
+        size_t data_size;
+    };
+
+    struct cue_track {
+        size_t file_index;
+        int track_num;
+        bool audio;
+        size_t start_frame; // INDEX 01, relative to the start of the file's data
+        std::string title;
+    };
+
+    // reads the next token, which may be a double-quoted string
+    std::string next_token(std::istringstream &line) {
+        line >> std::ws;
+        if (line.peek() == '"') {
+            line.get();
+            std::string token;
+            std::getline(line, token, '"');
+            return token;
+        }
+
+        std::string token;
+        line >> token;
+        return token;
+    }
+
+    std::expected<size_t, std::string> parse_msf(const std::string &msf) {
+        unsigned int minute, second, frame;
+        if (char extra; std::sscanf(msf.c_str(), "%u:%u:%u%c", &minute, &second, &frame, &extra) != 3
+                        || second >= CD_SECS || frame >= CD_FRAMES) {
+            return std::unexpected("Invalid INDEX time " + msf);
+        }
+        return (static_cast<size_t>(minute) * CD_SECS + second) * CD_FRAMES + frame;
+    }
+}
+
+namespace audipi {
+    ImagePlayerTrack::ImagePlayerTrack(std::shared_ptr<MappedFile> file, const size_t offset,
+                                       const size_t num_samples, std::string name)
+        : file(std::move(file)), name(std::move(name)) {
+        this->samples = std::span(reinterpret_cast<const sample_data *>(this->file->get_data() + offset), num_samples);
+    }
+
+    void ImagePlayerTrack::reset() {
+        this->position = 0;
+    }
+
+    std::expected<void, int> ImagePlayerTrack::seek(const msfs_location &location) {
+        this->position = std::min(msfs_location_to_samples(location), this->samples.size());
+        return {};
+    }
+
+    std::string ImagePlayerTrack::get_track_name() const {
+        return this->name;
+    }
+
+    std::expected<std::span<const sample_data>, int> ImagePlayerTrack::peek_samples() {
+        return this->samples.subspan(this->position);
+    }
+
+    void ImagePlayerTrack::consume_samples(const size_t num_samples) {
+        this->position = std::min(this->position + num_samples, this->samples.size());
+    }
+
+    bool ImagePlayerTrack::is_finished() const {
+        return this->position >= this->samples.size();
+    }
+
+    msfs_location ImagePlayerTrack::get_current_location() const {
+        return msfs_location{0, 0, 0, 0} + this->position;
+    }
+
+    std::expected<track_list, std::string> load_cue_sheet(const std::string &path) {
+        std::ifstream cue(path);
+        if (!cue) {
+            return std::unexpected("Cannot open " + path);
+        }
+
+        const auto directory = std::filesystem::path(path).parent_path();
+        std::vector<cue_file> files;
+        std::vector<cue_track> tracks;
+
+        std::string line_text;
+        while (std::getline(cue, line_text)) {
+            std::istringstream line(line_text);
+            std::string command;
+            line >> command;
+
+            if (command == "FILE") {
+                const auto file_name = next_token(line);
+                const auto file_type = next_token(line);
+                const auto file_path = (directory / file_name).string();
+
+                auto mapped = MappedFile::open(file_path);
+                if (!mapped) {
+                    return std::unexpected("Cannot map " + file_path + ": " + std::strerror(mapped.error()));
+                }
+
+                if (file_type == "BINARY") {
+                    files.push_back({mapped.value(), 0, mapped.value()->get_size()});
+                } else if (file_type == "WAVE") {
+                    const auto data = find_wav_data(*mapped.value());
+                    if (!data) {
+                        return std::unexpected(file_path + ": " + data.error());
+                    }
+                    files.push_back({mapped.value(), data->offset, data->size});
+                } else {
+                    return std::unexpected("Unsupported FILE type " + file_type);
+                }
+            } else if (command == "TRACK") {
+                if (files.empty()) {
+                    return std::unexpected("TRACK before FILE");
+                }
+                int track_num = 0;
+                line >> track_num;
+                tracks.push_back({files.size() - 1, track_num, next_token(line) == "AUDIO", 0, ""});
+            } else if (command == "INDEX" && !tracks.empty()) {
+                int index_num = -1;
+                line >> index_num;
+                if (index_num == 1) {
+                    const auto start_frame = parse_msf(next_token(line));
+                    if (!start_frame) {
+                        return std::unexpected(start_frame.error());
+                    }
+                    tracks.back().start_frame = start_frame.value();
+                }
+            } else if (command == "TITLE" && !tracks.empty()) {
+                tracks.back().title = next_token(line);
+            }
+        }
+
+        track_list player_tracks;
+
+        for (size_t i = 0; i < tracks.size(); ++i) {
+            const auto &track = tracks[i];
+            if (!track.audio) {
+                continue;
+            }
+
+            // a track runs up to the next track in the same file, or to the end of the file
+            const auto &file = files[track.file_index];
+            const size_t file_frames = file.data_size / CD_FRAMESIZE_RAW;
+            size_t end_frame = file_frames;
+            if (i + 1 < tracks.size() && tracks[i + 1].file_index == track.file_index) {
+                end_frame = std::min(tracks[i + 1].start_frame, file_frames);
+            }
+            if (track.start_frame >= end_frame) {
+                continue;
+            }
+
+            auto name = track.title.empty()
+                            ? std::string("Track ") + left_pad_string(std::to_string(track.track_num), 2, '0')
+                            : track.title;
+
+            player_tracks.push_back(std::make_unique<ImagePlayerTrack>(
+                file.file, file.data_offset + track.start_frame * CD_FRAMESIZE_RAW,
+                (end_frame - track.start_frame) * SAMPLES_IN_FRAME, std::move(name)));
+        }
+
+        if (player_tracks.empty()) {
+            return std::unexpected("No audio tracks in " + path);
+        }
+
+        return player_tracks;
+    }
+
+    std::expected<track_list, std::string> load_wav_file(const std::string &path) {
+        auto mapped = MappedFile::open(path);
+        if (!mapped) {
+            return std::unexpected("Cannot map " + path + ": " + std::strerror(mapped.error()));
+        }
+
+        const auto data = find_wav_data(*mapped.value());
+        if (!data) {
+            return std::unexpected(path + ": " + data.error());
+        }
+
+        track_list player_tracks;
+        player_tracks.push_back(std::make_unique<ImagePlayerTrack>(
+            mapped.value(), data->offset, data->size / sizeof(sample_data),
+            std::filesystem::path(path).stem().string()));
+        return player_tracks;
+    }
+
+    std::expected<track_list, std::string> load_disc_image(const std::string &path) {
+        auto extension = std::filesystem::path(path).extension().string();
+        std::ranges::transform(extension, extension.begin(), [](const unsigned char c) { return std::tolower(c); });
+
+        if (extension == ".cue") {
+            return load_cue_sheet(path);
+        }
+        if (extension == ".wav") {
+            return load_wav_file(path);
+        }
+        return std::unexpected("Unsupported disc image " + path);
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef IMAGEPLAYERTRACK_H
+#define IMAGEPLAYERTRACK_H
+
+#include <expected>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "PlayerTrack.h"
+#include "structs.h"
+
+namespace audipi {
+    /**
+    * @brief Track served straight out of a memory-mapped disc image (raw BIN sectors or WAV data).
+    * Samples are handed to the audio device from the mapping itself, the kernel's read-ahead takes the place of
+    * the read-ahead thread.
+    */
+    class ImagePlayerTrack final : public PlayerTrack {
+        std::shared_ptr<MappedFile> file;
+        std::span<const sample_data> samples;
+        std::string name;
+        size_t position = 0;
+
+    public:
+        /**
+        * @brief The track covers num_samples samples starting offset bytes into file.
+        */
+        ImagePlayerTrack(std::shared_ptr<MappedFile> file, size_t offset, size_t num_samples, std::string name);
+
+        void reset() override;
+
+        [[nodiscard]] std::expected<void, int> seek(const msfs_location &location) override;
+
+        [[nodiscard]] std::string get_track_name() const override;
+
+        /**
+        * @brief Returns the rest of the track, in place in the mapping.
+        */
+        [[nodiscard]] std::expected<std::span<const sample_data>, int> peek_samples() override;
+
+        void consume_samples(size_t num_samples) override;
+
+        [[nodiscard]] bool is_finished() const override;
+
+        [[nodiscard]] msfs_location get_current_location() const override;
+    };
+
+    using track_list = std::vector<std::unique_ptr<PlayerTrack>>;
+
+    /**
+    * @brief Loads the audio tracks of a CUE sheet, whose FILEs are either raw BINARY images with 2352-byte sectors
+    * or WAVE files.
+    */
+    [[nodiscard]] std::expected<track_list, std::string> load_cue_sheet(const std::string &path);
+
+    /**
+    * @brief Loads a 16-bit stereo 44.1 kHz PCM WAV file as a single track.
+    */
+    [[nodiscard]] std::expected<track_list, std::string> load_wav_file(const std::string &path);
+
+    /**
+    * @brief Loads a .cue or .wav disc image, depending on its extension.
+    */
+    [[nodiscard]] std::expected<track_list, std::string> load_disc_image(const std::string &path);
+}
+
+#endif //IMAGEPLAYERTRACK_H
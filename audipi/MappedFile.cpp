@@ -0,0 +1,52 @@
+#include "MappedFile.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace audipi {
+    MappedFile::MappedFile(const u_int8_t *data, const size_t size) : data(data), size(size) {
+    }
+
+    MappedFile::~MappedFile() {
+        if (this->size > 0) {
+            munmap(const_cast<u_int8_t *>(this->data), this->size);
+        }
+    }
+
+    std::expected<std::shared_ptr<MappedFile>, int> MappedFile::open(const std::string &path) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return std::unexpected(errno);
+        }
+
+        struct stat file_stat{};
+        if (fstat(fd, &file_stat) != 0) {
+            const int error = errno;
+            close(fd);
+            return std::unexpected(error);
+        }
+
+        const auto size = static_cast<size_t>(file_stat.st_size);
+        if (size == 0) {
+            close(fd);
+            return std::shared_ptr<MappedFile>(new MappedFile(nullptr, 0));
+        }
+
+        void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        const int error = errno;
+        // the mapping keeps the file alive on its own
+        close(fd);
+
+        if (mapping == MAP_FAILED) {
+            return std::unexpected(error);
+        }
+
+        // playback walks the file front to back: have the kernel read ahead aggressively and drop pages behind us
+        madvise(mapping, size, MADV_SEQUENTIAL);
+
+        return std::shared_ptr<MappedFile>(new MappedFile(static_cast<const u_int8_t *>(mapping), size));
+    }
+}
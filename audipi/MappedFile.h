@@ -0,0 +1,38 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <expected>
+#include <memory>
+#include <string>
+
+#include <sys/types.h>
+
+namespace audipi {
+    /**
+    * @brief Read-only memory mapping of a whole file, advised for sequential access.
+    */
+    class MappedFile {
+        const u_int8_t *data;
+        size_t size;
+
+        MappedFile(const u_int8_t *data, size_t size);
+
+    public:
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        [[nodiscard]] static std::expected<std::shared_ptr<MappedFile>, int> open(const std::string &path);
+
+        [[nodiscard]] const u_int8_t *get_data() const {
+            return data;
+        }
+
+        [[nodiscard]] size_t get_size() const {
+            return size;
+        }
+    };
+}
+
+#endif //MAPPEDFILE_H
@@ -0,0 +1,132 @@
+#include "NullSink.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "PlaybackClock.h"
+#include "Trace.h"
+
+namespace audipi {
+    NullSink::NullSink(const bool realtime) : realtime(realtime), last_update(std::chrono::steady_clock::now()) {
+        this->buffer_size = NULL_SINK_BUFFER_SAMPLES;
+        this->period_size = NULL_SINK_PERIOD_SAMPLES;
+        this->avail_min = NULL_SINK_PERIOD_SAMPLES;
+    }
+
+    void NullSink::update(const std::chrono::steady_clock::time_point now) {
+        if (this->running && !this->paused) {
+            const double elapsed = std::chrono::duration<double>(now - this->last_update).count();
+            const double playable = elapsed * static_cast<double>(SAMPLE_RATE);
+            if (playable >= this->queued) {
+                // ran dry: stop until the next write, as ALSA does on an xrun
+                this->played += this->queued;
+                this->queued = 0;
+                this->running = false;
+                AUDIPI_TRACE_INSTANT("NullSink::xrun");
+                if (this->metrics != nullptr) {
+                    this->metrics->xruns.fetch_add(1, std::memory_order_relaxed);
+                }
+            } else {
+                this->played += playable;
+                this->queued -= playable;
+            }
+        }
+        this->last_update = now;
+    }
+
+    std::expected<long, int> NullSink::enqueue_for_playback(const sample_data *, const size_t size) {
+        AUDIPI_TRACE_NAMED_SPAN(span, "NullSink::enqueue_for_playback");
+        AUDIPI_TRACE_SPAN_ARG(span, "samples", size);
+
+        std::lock_guard lg(this->mutex);
+        if (!this->realtime) {
+            this->played += static_cast<double>(size);
+            return static_cast<long>(size);
+        }
+
+        this->update(std::chrono::steady_clock::now());
+        const auto free = this->buffer_size - static_cast<unsigned long>(std::ceil(this->queued));
+        const auto taken = std::min(static_cast<unsigned long>(size), free);
+        this->queued += static_cast<double>(taken);
+        if (taken > 0) {
+            this->running = true;
+        }
+        return static_cast<long>(taken);
+    }
+
+    void NullSink::prepare() {
+        std::lock_guard lg(this->mutex);
+        this->queued = 0;
+        this->running = false;
+        this->paused = false;
+    }
+
+    void NullSink::pause() {
+        std::lock_guard lg(this->mutex);
+        this->update(std::chrono::steady_clock::now());
+        this->paused = true;
+    }
+
+    void NullSink::resume() {
+        std::lock_guard lg(this->mutex);
+        this->update(std::chrono::steady_clock::now());
+        this->paused = false;
+    }
+
+    void NullSink::reset() {
+        this->prepare();
+    }
+
+    std::expected<bool, int> NullSink::wait_for_space(const int timeout_ms) {
+        AUDIPI_TRACE_SPAN("NullSink::wait_for_space");
+
+        if (!this->realtime) {
+            return true;
+        }
+
+        std::unique_lock lock(this->mutex);
+        this->update(std::chrono::steady_clock::now());
+        const double over = this->queued - static_cast<double>(this->buffer_size - this->avail_min);
+        const bool draining = this->running && !this->paused;
+        lock.unlock();
+
+        if (over <= 0) {
+            return true;
+        }
+        const auto timeout = std::chrono::milliseconds(timeout_ms);
+        const auto needed = std::chrono::duration<double>(over / static_cast<double>(SAMPLE_RATE));
+        if (!draining || needed > timeout) {
+            std::this_thread::sleep_for(timeout);
+            return false;
+        }
+        std::this_thread::sleep_for(needed);
+        return true;
+    }
+
+    std::expected<unsigned long, long> NullSink::get_available_samples() {
+        std::lock_guard lg(this->mutex);
+        if (!this->realtime) {
+            return this->buffer_size;
+        }
+        this->update(std::chrono::steady_clock::now());
+        return this->buffer_size - static_cast<unsigned long>(std::ceil(this->queued));
+    }
+
+    std::expected<device_timestamp, int> NullSink::get_timestamp() {
+        std::lock_guard lg(this->mutex);
+        const auto now = std::chrono::steady_clock::now();
+        if (!this->realtime) {
+            return device_timestamp{0, now, false};
+        }
+        this->update(now);
+        return device_timestamp{static_cast<unsigned long>(std::ceil(this->queued)), now,
+                                this->running && !this->paused};
+    }
+
+    unsigned long NullSink::get_played_samples() {
+        std::lock_guard lg(this->mutex);
+        this->update(std::chrono::steady_clock::now());
+        return static_cast<unsigned long>(this->played);
+    }
+}
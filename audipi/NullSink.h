@@ -0,0 +1,63 @@
+#ifndef NULLSINK_H
+#define NULLSINK_H
+
+#include <chrono>
+#include <mutex>
+
+#include "AudioSink.h"
+
+namespace audipi {
+    // sized like the balanced latency profile: 200 ms of buffer in 50 ms periods
+    constexpr unsigned long NULL_SINK_BUFFER_SAMPLES = 8820;
+    constexpr unsigned long NULL_SINK_PERIOD_SAMPLES = 2205;
+
+    /**
+    * @brief Discards samples, so that the player runs without a sound card: flat out, taking everything at once,
+    * or in real time, playing the buffer out at 44.1 kHz and running dry (an xrun) when not refilled in time.
+    */
+    class NullSink final : public AudioSink {
+        const bool realtime;
+
+        // guards the buffer model, the output thread waits on it outside the player lock
+        std::mutex mutex;
+        double queued = 0; // samples written and not played yet, in real time mode
+        bool running = false;
+        bool paused = false;
+        std::chrono::steady_clock::time_point last_update;
+        double played = 0;
+
+        // plays out what the time since the last update allows, the caller holds mutex
+        void update(std::chrono::steady_clock::time_point now);
+
+    public:
+        explicit NullSink(bool realtime = false);
+
+        [[nodiscard]] bool is_init() const override {
+            return true;
+        }
+
+        [[nodiscard]] std::expected<long, int> enqueue_for_playback(const sample_data *buffer,
+                                                                    std::size_t size) override;
+
+        void prepare() override;
+
+        void pause() override;
+
+        void resume() override;
+
+        void reset() override;
+
+        [[nodiscard]] std::expected<bool, int> wait_for_space(int timeout_ms) override;
+
+        [[nodiscard]] std::expected<unsigned long, long> get_available_samples() override;
+
+        [[nodiscard]] std::expected<device_timestamp, int> get_timestamp() override;
+
+        /**
+        * @brief Samples played so far, all of those written when not in real time mode.
+        */
+        [[nodiscard]] unsigned long get_played_samples();
+    };
+}
+
+#endif //NULLSINK_H
@@ -0,0 +1,334 @@
+#include "PersistentCache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/cdrom.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Trace.h"
+
+constexpr char CACHE_MAGIC[8] = {'A', 'U', 'D', 'I', 'P', 'I', 'F', 'C'};
+constexpr u_int32_t CACHE_VERSION = 1;
+constexpr const char *CACHE_EXTENSION = ".frames";
+constexpr size_t CACHE_PAGE_SIZE = 4096;
+// room made for the disc being played at a time, once what the other discs take leaves it none
+constexpr size_t EVICTION_STEP_FRAMES = 60 * CD_FRAMES;
+// left out of the budget of a disc for what the filesystem itself allocates to keep track of a sparse file
+constexpr size_t FILESYSTEM_SLACK_BYTES = 16 * CACHE_PAGE_SIZE;
+
+namespace {
+    struct cache_header {
+        char magic[8];
+        u_int32_t version;
+        u_int32_t frame_size;
+        u_int64_t first_frame;
+        u_int64_t total_frames;
+    };
+
+    size_t frames_offset(const size_t total_frames) {
+        const size_t end_of_checksums = sizeof(cache_header) + total_frames * sizeof(u_int32_t);
+        return (end_of_checksums + CACHE_PAGE_SIZE - 1) / CACHE_PAGE_SIZE * CACHE_PAGE_SIZE;
+    }
+
+    // FNV-1a, never 0 so that 0 can mark a frame that has not been stored
+    u_int32_t frame_checksum(const u_int8_t *raw_data) {
+        u_int32_t hash = 2166136261u;
+        for (size_t i = 0; i < CD_FRAMESIZE_RAW; ++i) {
+            hash = (hash ^ raw_data[i]) * 16777619u;
+        }
+        return hash == 0 ? 1 : hash;
+    }
+
+    // the files are sparse: only count what is actually stored
+    size_t stored_bytes(const struct stat &file_stat) {
+        return static_cast<size_t>(file_stat.st_blocks) * 512;
+    }
+
+    // removes the least recently played discs other than keep, until they take no more than max_bytes together;
+    // returns what they still take
+    size_t evict(const std::filesystem::path &directory, const std::filesystem::path &keep, const size_t max_bytes) {
+        struct cached_disc {
+            std::filesystem::path path;
+            time_t last_used;
+            size_t bytes;
+        };
+
+        std::vector<cached_disc> discs;
+        size_t total_bytes = 0;
+
+        std::error_code ec;
+        for (const auto &entry: std::filesystem::directory_iterator(directory, ec)) {
+            if (entry.path().extension() != CACHE_EXTENSION || entry.path() == keep) {
+                continue;
+            }
+
+            struct stat file_stat{};
+            if (stat(entry.path().c_str(), &file_stat) != 0) {
+                continue;
+            }
+
+            const size_t bytes = stored_bytes(file_stat);
+            total_bytes += bytes;
+            discs.push_back({entry.path(), file_stat.st_mtime, bytes});
+        }
+
+        std::ranges::sort(discs, {}, &cached_disc::last_used);
+
+        for (const auto &disc: discs) {
+            if (total_bytes <= max_bytes) {
+                break;
+            }
+#if AUDIPI_DEBUG
+            printf("Evicting %s from the persistent cache\n", disc.path.c_str());
+#endif
+            if (std::filesystem::remove(disc.path, ec)) {
+                total_bytes -= disc.bytes;
+            }
+        }
+        return total_bytes;
+    }
+
+}
+
+namespace audipi {
+    std::string compute_disc_id(const disk_toc &toc) {
+        u_int64_t hash = 14695981039346656037ull;
+        const auto add = [&hash](const size_t value) {
+            for (size_t i = 0; i < sizeof(u_int32_t); ++i) {
+                hash = (hash ^ ((value >> (i * 8)) & 0xff)) * 1099511628211ull;
+            }
+        };
+
+        add(toc.start_track);
+        add(toc.end_track);
+        for (const auto &entry: toc.entries) {
+            add(msf_location_to_frames(entry.address));
+        }
+        if (!toc.entries.empty()) {
+            // durations are derived from the lead-out, so the last track ends on it
+            const auto &last = toc.entries.back();
+            add(msf_location_to_frames(last.address) + msf_location_to_frames(last.duration));
+        }
+
+        char id[17];
+        snprintf(id, sizeof(id), "%016llx", static_cast<unsigned long long>(hash));
+        return id;
+    }
+
+    PersistentCache::PersistentCache(const int fd, u_int8_t *mapping, const size_t mapping_size,
+                                     const size_t first_frame, const size_t total_frames,
+                                     std::filesystem::path directory, std::filesystem::path path,
+                                     const size_t max_bytes, const size_t other_bytes)
+        : fd(fd), mapping(mapping), mapping_size(mapping_size),
+          checksums(reinterpret_cast<u_int32_t *>(mapping + sizeof(cache_header))),
+          frames(mapping + frames_offset(total_frames)), first_frame(first_frame), total_frames(total_frames),
+          directory(std::move(directory)), path(std::move(path)), max_bytes(max_bytes),
+          budget_bytes(bytes_left_by(other_bytes)), other_bytes(other_bytes), frame_bytes(0) {
+        size_t used_pages = 0;
+        for (size_t page = 0; page * CACHE_PAGE_SIZE < total_frames * CD_FRAMESIZE_RAW; ++page) {
+            used_pages += this->is_page_used(page, total_frames) ? 1 : 0;
+        }
+        this->frame_bytes = used_pages * CACHE_PAGE_SIZE;
+    }
+
+    size_t PersistentCache::bytes_left_by(const size_t other_bytes) const {
+        const size_t reserved = other_bytes + frames_offset(this->total_frames) + FILESYSTEM_SLACK_BYTES;
+        return this->max_bytes - std::min(reserved, this->max_bytes);
+    }
+
+    bool PersistentCache::is_page_used(const size_t page, const size_t except_index) const {
+        const size_t first_index = page * CACHE_PAGE_SIZE / CD_FRAMESIZE_RAW;
+        const size_t end_index = std::min(((page + 1) * CACHE_PAGE_SIZE + CD_FRAMESIZE_RAW - 1) / CD_FRAMESIZE_RAW,
+                                          this->total_frames);
+        for (size_t index = first_index; index < end_index; ++index) {
+            if (index != except_index
+                && std::atomic_ref(this->checksums[index]).load(std::memory_order_relaxed) != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t PersistentCache::new_bytes_for(const size_t index) const {
+        const size_t first_page = index * CD_FRAMESIZE_RAW / CACHE_PAGE_SIZE;
+        const size_t end_page = ((index + 1) * CD_FRAMESIZE_RAW + CACHE_PAGE_SIZE - 1) / CACHE_PAGE_SIZE;
+        size_t bytes = 0;
+        for (size_t page = first_page; page < end_page; ++page) {
+            bytes += this->is_page_used(page, index) ? 0 : CACHE_PAGE_SIZE;
+        }
+        return bytes;
+    }
+
+    bool PersistentCache::make_room(const size_t needed_bytes) {
+        std::lock_guard lg(this->eviction_mutex);
+        const size_t used = this->frame_bytes;
+        if (used + needed_bytes <= this->budget_bytes) {
+            // made by another thread in the meantime
+            return true;
+        }
+        if (this->other_bytes == 0) {
+            return false;
+        }
+
+        AUDIPI_TRACE_NAMED_SPAN(span, "PersistentCache::make_room");
+        const size_t wanted = frames_offset(this->total_frames) + FILESYSTEM_SLACK_BYTES + used
+                              + EVICTION_STEP_FRAMES * CD_FRAMESIZE_RAW;
+        this->other_bytes = evict(this->directory, this->path, this->max_bytes - std::min(wanted, this->max_bytes));
+        this->budget_bytes = this->bytes_left_by(this->other_bytes);
+        return used + needed_bytes <= this->budget_bytes;
+    }
+
+    PersistentCache::~PersistentCache() {
+        munmap(this->mapping, this->mapping_size);
+        close(this->fd);
+    }
+
+    std::string PersistentCache::default_directory() {
+        if (const char *cache_home = getenv("XDG_CACHE_HOME"); cache_home != nullptr && cache_home[0] != '\0') {
+            return std::string(cache_home) + "/audipi";
+        }
+        if (const char *home = getenv("HOME"); home != nullptr && home[0] != '\0') {
+            return std::string(home) + "/.cache/audipi";
+        }
+        return "";
+    }
+
+    std::expected<std::shared_ptr<PersistentCache>, int> PersistentCache::open(
+        const std::string &directory, const disk_toc &toc, const size_t max_bytes) {
+        if (toc.entries.empty()) {
+            return std::unexpected(EINVAL);
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        if (ec) {
+            return std::unexpected(ec.value());
+        }
+
+        const auto &last = toc.entries.back();
+        const size_t first_frame = msf_location_to_frames(toc.entries.front().address);
+        const size_t total_frames = msf_location_to_frames(last.address) + msf_location_to_frames(last.duration)
+                                    - first_frame;
+        const size_t file_size = frames_offset(total_frames) + total_frames * CD_FRAMESIZE_RAW;
+
+        const auto path = std::filesystem::path(directory) / (compute_disc_id(toc) + CACHE_EXTENSION);
+
+        const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            return std::unexpected(errno);
+        }
+
+        cache_header header{};
+        struct stat file_stat{};
+        const bool valid = fstat(fd, &file_stat) == 0 && static_cast<size_t>(file_stat.st_size) == file_size
+                           && pread(fd, &header, sizeof(header), 0) == sizeof(header)
+                           && memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0
+                           && header.version == CACHE_VERSION && header.frame_size == CD_FRAMESIZE_RAW
+                           && header.first_frame == first_frame && header.total_frames == total_frames;
+
+        if (!valid) {
+            // new disc, or a stale file from another layout: start from an empty sparse file
+            if (ftruncate(fd, 0) != 0 || ftruncate(fd, static_cast<off_t>(file_size)) != 0) {
+                const int error = errno;
+                close(fd);
+                return std::unexpected(error);
+            }
+        }
+
+        // the header and the checksums are written in place: a disk too full to hold them means no cache at all
+        if (const int error = posix_fallocate(fd, 0, static_cast<off_t>(frames_offset(total_frames))); error != 0) {
+            close(fd);
+            return std::unexpected(error);
+        }
+
+        // the modification time orders discs for eviction
+        futimens(fd, nullptr);
+
+        void *mapping = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            const int error = errno;
+            close(fd);
+            return std::unexpected(error);
+        }
+
+        if (!valid) {
+            memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+            header.version = CACHE_VERSION;
+            header.frame_size = CD_FRAMESIZE_RAW;
+            header.first_frame = first_frame;
+            header.total_frames = total_frames;
+            memcpy(mapping, &header, sizeof(header));
+        }
+
+        // what this disc already takes stays, the others make room for it
+        const size_t own_bytes = valid ? stored_bytes(file_stat) : 0;
+        const size_t other_bytes = evict(directory, path, max_bytes - std::min(own_bytes, max_bytes));
+
+#if AUDIPI_DEBUG
+        printf("Opened persistent cache %s (%s)\n", path.c_str(), valid ? "existing" : "new");
+#endif
+
+        return std::shared_ptr<PersistentCache>(
+            new PersistentCache(fd, static_cast<u_int8_t *>(mapping), file_size, first_frame, total_frames, directory,
+                                path, max_bytes, other_bytes));
+    }
+
+    const u_int8_t *PersistentCache::get_frame(const size_t frame) const {
+        if (frame < this->first_frame || frame >= this->first_frame + this->total_frames) {
+            return nullptr;
+        }
+
+        const size_t index = frame - this->first_frame;
+        const u_int32_t checksum = std::atomic_ref(this->checksums[index]).load(std::memory_order_acquire);
+        if (checksum == 0) {
+            return nullptr;
+        }
+
+        const u_int8_t *raw_data = this->frames + index * CD_FRAMESIZE_RAW;
+        if (frame_checksum(raw_data) != checksum) {
+            AUDIPI_TRACE_INSTANT("PersistentCache::verification_failed", "frame", frame);
+            return nullptr;
+        }
+        return raw_data;
+    }
+
+    void PersistentCache::store_frames(const size_t frame, const size_t nframes, const u_int8_t *raw_data) {
+        for (size_t i = 0; i < nframes && this->writable.load(std::memory_order_relaxed); ++i) {
+            if (frame + i < this->first_frame || frame + i >= this->first_frame + this->total_frames) {
+                continue;
+            }
+            const size_t index = frame + i - this->first_frame;
+            std::atomic_ref checksum(this->checksums[index]);
+            if (checksum.load(std::memory_order_relaxed) != 0) {
+                continue;
+            }
+
+            // the pages the frame shares with stored neighbours are already counted
+            const size_t new_bytes = this->new_bytes_for(index);
+            if (this->frame_bytes + new_bytes > this->budget_bytes && !this->make_room(new_bytes)) {
+                return;
+            }
+
+            // writing into a hole the disk has no room for would fault, with SIGBUS instead of an error
+            const size_t offset = static_cast<size_t>(this->frames - this->mapping) + index * CD_FRAMESIZE_RAW;
+            if (const int error = posix_fallocate(this->fd, static_cast<off_t>(offset), CD_FRAMESIZE_RAW); error != 0) {
+                AUDIPI_TRACE_INSTANT("PersistentCache::reserve_error", "error", error);
+                this->writable = false;
+                return;
+            }
+
+            // the data must be in place before the checksum marks the frame as stored
+            u_int8_t *destination = this->frames + index * CD_FRAMESIZE_RAW;
+            memcpy(destination, raw_data + i * CD_FRAMESIZE_RAW, CD_FRAMESIZE_RAW);
+            checksum.store(frame_checksum(destination), std::memory_order_release);
+            this->frame_bytes += new_bytes;
+        }
+    }
+}
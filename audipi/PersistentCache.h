@@ -0,0 +1,100 @@
+#ifndef PERSISTENTCACHE_H
+#define PERSISTENTCACHE_H
+
+#include <atomic>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "structs.h"
+
+namespace audipi {
+    /**
+    * @brief Identifies a disc by its track layout: a hash of the track offsets and the lead-out.
+    */
+    std::string compute_disc_id(const disk_toc &toc);
+
+    /**
+    * @brief On-disk store of the audio frames read from one disc, shared by all the tracks of that disc.
+    *
+    * Each disc gets a single sparse file in the cache directory, named after its disc id and mapped into memory:
+    * a header, one checksum per frame (0 while the frame has not been stored) and the raw frames themselves.
+    * Only frames that were read successfully are stored, and a frame is only served back if its checksum matches,
+    * so repeated plays and seeks never need to wake the drive up.
+    * The directory as a whole is kept under a size cap by evicting the least recently played discs, when a disc is
+    * opened and again whenever the one being played needs more room than the others leave it.
+    * Disk space is reserved before anything is written through the mapping, so that a full disk only stops the cache
+    * from growing instead of faulting on a write into a hole of the file.
+    */
+    class PersistentCache {
+        int fd; // kept open to reserve space for frames as they are stored
+        u_int8_t *mapping;
+        size_t mapping_size;
+        u_int32_t *checksums;
+        u_int8_t *frames;
+
+        size_t first_frame; // absolute frame number of the first frame of the disc
+        size_t total_frames;
+
+        const std::filesystem::path directory;
+        const std::filesystem::path path;
+        const size_t max_bytes; // for the whole directory
+
+        // room for frames this disc has next to what the other discs take, raised by evicting them once reached
+        std::atomic<size_t> budget_bytes;
+        std::mutex eviction_mutex;
+        size_t other_bytes; // under eviction_mutex
+        // disk space the stored frames take, in whole pages as the disk allocates them
+        std::atomic<size_t> frame_bytes;
+        // cleared once the disk has no room left for another frame, nothing is stored from then on
+        std::atomic<bool> writable{true};
+
+        PersistentCache(int fd, u_int8_t *mapping, size_t mapping_size, size_t first_frame, size_t total_frames,
+                        std::filesystem::path directory, std::filesystem::path path, size_t max_bytes,
+                        size_t other_bytes);
+
+        [[nodiscard]] size_t bytes_left_by(size_t other_bytes) const;
+
+        // whether a stored frame other than except_index lies in page of the frames
+        [[nodiscard]] bool is_page_used(size_t page, size_t except_index) const;
+
+        // disk space storing the frame at index takes on top of its stored neighbours
+        [[nodiscard]] size_t new_bytes_for(size_t index) const;
+
+        // evicts other discs to let this one grow, returns whether it may take another needed_bytes
+        bool make_room(size_t needed_bytes);
+
+    public:
+        ~PersistentCache();
+
+        PersistentCache(const PersistentCache &) = delete;
+        PersistentCache &operator=(const PersistentCache &) = delete;
+
+        /**
+        * @brief Opens (or creates) the store of the disc described by toc in directory, evicting the least recently
+        * used other discs until the directory fits into max_bytes.
+        */
+        [[nodiscard]] static std::expected<std::shared_ptr<PersistentCache>, int> open(
+            const std::string &directory, const disk_toc &toc, size_t max_bytes);
+
+        /**
+        * @brief $XDG_CACHE_HOME/audipi, or ~/.cache/audipi.
+        */
+        [[nodiscard]] static std::string default_directory();
+
+        /**
+        * @brief Returns the raw data of a stored frame (CD_FRAMESIZE_RAW bytes), in place in the mapping,
+        * or nullptr if the frame has not been stored or fails verification.
+        */
+        [[nodiscard]] const u_int8_t *get_frame(size_t frame) const;
+
+        /**
+        * @brief Stores nframes contiguous frames of raw data read from the drive, as far as the size cap allows.
+        */
+        void store_frames(size_t frame, size_t nframes, const u_int8_t *raw_data);
+    };
+}
+
+#endif //PERSISTENTCACHE_H
@@ -0,0 +1,56 @@
+#ifndef PLAYBACKCLOCK_H
+#define PLAYBACKCLOCK_H
+
+#include <algorithm>
+#include <chrono>
+#include <linux/cdrom.h>
+
+#include "SeqLock.h"
+#include "structs.h"
+
+namespace audipi {
+    constexpr size_t SAMPLE_RATE = SAMPLES_IN_FRAME * CD_FRAMES;
+
+    /**
+    * @brief Where playback was at a point in time, as measured on the audio device.
+    */
+    struct playback_anchor {
+        size_t heard_samples; // into the track, of the sample leaving the device at time
+        size_t queued_samples; // into the track, of the end of what the device was given: the clock stops there
+        std::chrono::steady_clock::time_point time;
+        bool running; // false while paused, stopped or before the device starts
+
+        [[nodiscard]] size_t samples_at(const std::chrono::steady_clock::time_point now) const {
+            if (!running || now <= time) {
+                return heard_samples;
+            }
+
+            const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - time).count();
+            const auto advanced = static_cast<size_t>(elapsed * static_cast<long>(SAMPLE_RATE) / 1000000000L);
+            // never past what was written: an underrun or a stalled output thread must not run the clock ahead
+            return std::min(heard_samples + advanced, std::max(queued_samples, heard_samples));
+        }
+    };
+
+    /**
+    * @brief Position of the sample being heard, interpolated from the last anchor the output thread took off the
+    * audio device. Readers never touch the device or a lock, so that front ends can ask at any refresh rate.
+    */
+    class PlaybackClock {
+        SeqLock<playback_anchor> anchor;
+
+    public:
+        /**
+        * @brief Publishes a new anchor. Concurrent writers must be serialized by the caller.
+        */
+        void set(const playback_anchor &value) {
+            anchor.store(value);
+        }
+
+        [[nodiscard]] msfs_location location_at(const std::chrono::steady_clock::time_point now) const {
+            return msfs_location{0, 0, 0, 0} + anchor.load().samples_at(now);
+        }
+    };
+}
+
+#endif //PLAYBACKCLOCK_H
@@ -1,6 +1,11 @@
 #include "Player.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <linux/cdrom.h>
+
+#include "Trace.h"
 
 const audipi::Player::player_status ERROR_PLAYER_STATUS = {
     audipi::PlayerState::ERROR,
@@ -9,7 +14,10 @@ const audipi::Player::player_status ERROR_PLAYER_STATUS = {
     {}
 };
 
-constexpr int sufficient_samples = 11050; // 0.25 s
+// upper bound on a single wait, so that state changes are picked up even if the device never wakes us
+constexpr int OUTPUT_WAIT_TIMEOUT_MS = 100;
+// how long to back off when the read-ahead thread has nothing ready for the device
+constexpr auto UNDERRUN_BACKOFF = std::chrono::milliseconds(5);
 
 namespace audipi {
     void Player::set_error(const char *error) {
@@ -17,137 +25,437 @@ namespace audipi {
         this->state = PlayerState::ERROR;
     }
 
-    Player::Player() = default;
+    Player::Player(const unsigned int read_ahead_seconds, const audio_device_config &audio_config)
+        : Player(std::make_unique<AudioDevice>(audio_config), read_ahead_seconds) {
+    }
+
+    Player::Player(std::unique_ptr<AudioSink> sink, const unsigned int read_ahead_seconds)
+        : audio_sink(std::move(sink)), reader(read_ahead_seconds * CD_FRAMES),
+          output_thread(&Player::run_output, this) {
+        this->audio_sink->set_metrics(&this->metrics);
+        this->status.store(this->published_status);
+    }
+
+    Player::~Player() {
+        {
+            std::lock_guard lg(this->mutex);
+            this->running = false;
+        }
+        this->state_changed.notify_all();
+        this->output_thread.join();
+    }
 
     bool Player::is_init() const {
-        return this->audio_device.is_init();
+        return this->audio_sink->is_init();
     }
 
     void Player::enqueue_cd(CdRom &cd_rom, const disk_toc &toc) {
+        std::lock_guard lg(this->mutex);
+
+        std::shared_ptr<PersistentCache> persistent_cache;
+        if (!this->persistent_cache_directory.empty()) {
+            if (auto result = PersistentCache::open(this->persistent_cache_directory, toc,
+                                                    this->persistent_cache_bytes)) {
+                persistent_cache = std::move(result.value());
+            } else {
+#if AUDIPI_DEBUG
+                printf("Cannot open persistent cache: %s\n", strerror(result.error()));
+#endif
+            }
+        }
+
+        const auto buffer = SampleBuffer::for_disc(toc, this->cache_bytes);
+
+        SpeedGovernor *speed_governor = nullptr;
+        if (this->speed_control) {
+            speed_governor = this->speed_governors.emplace_back(
+                std::make_unique<SpeedGovernor>(cd_rom, this->speed_control.value(), &this->metrics)).get();
+        }
+
         for (const auto &track: toc.entries) {
-            CdPlayerTrack player_track(cd_rom, track);
-            player_track.prefetch_samples(5*44100);
-            this->tracks.push_back(player_track);
+            auto player_track = std::make_unique<CdPlayerTrack>(cd_rom, track, buffer, persistent_cache);
+            player_track->set_subchannel_mode(this->subchannel_polling);
+            player_track->set_read_mode(this->reading_mode);
+            player_track->set_speed_governor(speed_governor);
+            player_track->set_metrics(&this->metrics);
+            this->tracks.push_back(std::move(player_track));
         }
+        // the start of the tracks is read in the background, enqueuing only costs the TOC
+        this->follow_current_track();
+        this->publish_status();
+    }
+
+    std::expected<void, std::string> Player::enqueue_image(const std::string &path) {
+        auto image_tracks = load_disc_image(path);
+        if (!image_tracks) {
+            return std::unexpected(image_tracks.error());
+        }
+
+        std::lock_guard lg(this->mutex);
+
+        for (auto &track: image_tracks.value()) {
+            this->tracks.push_back(std::move(track));
+        }
+        this->follow_current_track();
+        this->publish_status();
+        return {};
+    }
+
+    void Player::enqueue_track(std::unique_ptr<PlayerTrack> track) {
+        std::lock_guard lg(this->mutex);
+
+        this->tracks.push_back(std::move(track));
+        this->follow_current_track();
+        this->publish_status();
     }
 
     void Player::play() {
+        std::lock_guard lg(this->mutex);
+
         if (this->state == PlayerState::PLAYING) {
             return;
         }
 
         if (this->state == PlayerState::PAUSED) {
             this->state = PlayerState::PLAYING;
-            this->audio_device.resume();
+            this->audio_sink->resume();
         } else {
             this->state = PlayerState::PLAYING;
-            this->current_track = 0;
-            this->tracks[current_track].reset();
-            this->audio_device.prepare();
+            this->switch_track(0);
+            this->audio_sink->prepare();
         }
+        this->publish_status();
+        this->state_changed.notify_all();
     }
 
     void Player::pause() {
+        std::lock_guard lg(this->mutex);
+
         if (this->state == PlayerState::PLAYING) {
             this->state = PlayerState::PAUSED;
-            this->audio_device.pause();
+            this->audio_sink->pause();
+            this->publish_status();
         }
     }
 
     void Player::stop() {
+        std::lock_guard lg(this->mutex);
+
+        this->stop_playback();
+        this->follow_current_track();
+        this->publish_status();
+    }
+
+    void Player::stop_playback() {
+        this->reader.set_track(nullptr);
         if (this->state == PlayerState::PLAYING || this->state == PlayerState::PAUSED) {
-            this->tracks[current_track].reset();
+            this->tracks[current_track]->reset();
         }
         this->state = PlayerState::STOPPED;
         this->current_track = 0;
-        this->audio_device.reset();
+        this->audio_sink->reset();
+    }
+
+    bool Player::is_playlist_written() const {
+        return !this->tracks.empty() && this->current_track + 1 == this->tracks.size()
+               && this->tracks[current_track]->is_finished();
     }
 
     void Player::next_track() {
+        std::lock_guard lg(this->mutex);
+
         if (current_track >= tracks.size() - 1)
             return;
-        this->tracks[current_track++].reset();
-        this->tracks[current_track].reset();
-        this->audio_device.reset();
+        this->switch_track(current_track + 1);
+        this->audio_sink->reset();
+        this->publish_status();
     }
 
     void Player::prev_track() {
+        std::lock_guard lg(this->mutex);
+
         if (current_track <= 0)
             return;
-        this->tracks[current_track--].reset();
-        this->tracks[current_track].reset();
-        this->audio_device.reset();
+        this->switch_track(current_track - 1);
+        this->audio_sink->reset();
+        this->publish_status();
     }
 
     std::expected<void, std::string> Player::jump_to_track(const size_t track_idx) {
+        std::lock_guard lg(this->mutex);
+
         if (track_idx < 0 || track_idx >= this->tracks.size()) {
             return std::unexpected("Out of bounds");
         }
-        this->tracks[current_track].reset();
-        this->current_track = track_idx;
-        this->tracks[current_track].reset();
-        this->audio_device.reset();
+        this->switch_track(track_idx);
+        this->audio_sink->reset();
+        this->publish_status();
+        return {};
+    }
+
+    std::expected<void, std::string> Player::seek(const msfs_location &location) {
+        std::lock_guard lg(this->mutex);
+
+        return this->seek_current_track(location);
+    }
+
+    std::expected<void, std::string> Player::seek_relative(const long offset_samples) {
+        std::lock_guard lg(this->mutex);
+
+        const auto heard = this->get_heard_location();
+        if (!heard) {
+            return std::unexpected(heard.error());
+        }
+
+        const auto position = static_cast<long>(msfs_location_to_samples(heard.value()));
+        const auto target = static_cast<size_t>(std::max(position + offset_samples, 0L));
+        return this->seek_current_track(msfs_location{0, 0, 0, 0} + target);
+    }
+
+    std::expected<void, std::string> Player::seek_current_track(const msfs_location &location) {
+        if (this->state != PlayerState::PLAYING && this->state != PlayerState::PAUSED) {
+            return std::unexpected("Not playing");
+        }
+
+        // the read-ahead thread must let go of the track before its queue can be moved
+        this->reader.set_track(nullptr);
+        const auto result = this->tracks[current_track]->seek(location);
+        this->audio_sink->reset();
+        this->follow_current_track();
+        this->publish_status();
+
+        if (!result) {
+            return std::unexpected(std::string("Cannot read at seek location: ") + strerror(result.error()));
+        }
         return {};
     }
 
     void Player::clear_playlist() {
-        this->stop();
+        std::lock_guard lg(this->mutex);
+
+        this->stop_playback();
         this->tracks.clear();
+        this->speed_governors.clear();
         this->current_track = 0;
+        this->publish_status();
     }
 
-    void Player::tick() {
-        if (this->state == PlayerState::ERROR || this->state == PlayerState::STOPPED) {
+    void Player::set_read_ahead_seconds(const unsigned int seconds) {
+        this->reader.set_read_ahead_frames(seconds * CD_FRAMES);
+    }
+
+    void Player::set_cache_bytes(const size_t max_bytes) {
+        std::lock_guard lg(this->mutex);
+
+        this->cache_bytes = max_bytes;
+    }
+
+    void Player::set_subchannel_mode(const subchannel_mode mode) {
+        std::lock_guard lg(this->mutex);
+
+        this->subchannel_polling = mode;
+    }
+
+    void Player::set_read_mode(const read_mode mode) {
+        std::lock_guard lg(this->mutex);
+
+        this->reading_mode = mode;
+    }
+
+    void Player::set_speed_control(const std::optional<speed_governor_config> &config) {
+        std::lock_guard lg(this->mutex);
+
+        this->speed_control = config;
+    }
+
+    void Player::set_persistent_cache(const std::string &directory, const size_t max_bytes) {
+        std::lock_guard lg(this->mutex);
+
+        this->persistent_cache_directory = directory;
+        this->persistent_cache_bytes = max_bytes;
+    }
+
+    void Player::switch_track(const size_t track_idx) {
+        // the read-ahead thread must let go of the tracks before their queues can be rewound
+        this->reader.set_track(nullptr);
+        this->tracks[current_track]->reset();
+        this->current_track = track_idx;
+        this->tracks[current_track]->reset();
+        this->follow_current_track();
+    }
+
+    void Player::advance_track() {
+        const size_t previous = this->current_track;
+        this->current_track = previous + 1;
+
+        // the next track is left as the reader pre-rolled it, the finished one goes back to its start once the
+        // reader is done with any read on it: the output thread never waits for the drive
+        PlayerTrack *current = this->tracks[current_track].get();
+        PlayerTrack *next = current_track + 1 < this->tracks.size() ? this->tracks[current_track + 1].get() : nullptr;
+        PlayerTrack *finished = this->tracks[previous].get();
+        this->reader.advance_to(current, {next, finished}, next, finished);
+    }
+
+    void Player::follow_current_track() {
+        if (this->tracks.empty()) {
             return;
         }
 
-#if AUDIPI_DEBUG
-        printf("Player::tick %ld\n", std::chrono::system_clock::now().time_since_epoch().count());
-#endif
+        PlayerTrack *current = this->tracks[current_track].get();
+        PlayerTrack *next = current_track + 1 < this->tracks.size() ? this->tracks[current_track + 1].get() : nullptr;
+        PlayerTrack *prev = current_track > 0 ? this->tracks[current_track - 1].get() : nullptr;
 
-        if (this->state == PlayerState::PLAYING) {
-            const auto samples_in_buffer_maybe = audio_device.get_samples_in_buffer();
-            if (!samples_in_buffer_maybe) {
-#if AUDIPI_DEBUG
-                printf("  Error reading samples in audio device buffer: %ld\n", samples_in_buffer_maybe.error());
-#endif
-                this->set_error("Error reading sample count in audio device buffer in tick");
-                return;
+        if (this->state == PlayerState::PLAYING || this->state == PlayerState::PAUSED) {
+            // listeners skip forward far more often than back
+            this->reader.set_track(current, {next, prev}, next);
+        } else if (this->state == PlayerState::STOPPED) {
+            // nothing plays yet, get the tracks play() would start from ready
+            this->reader.set_track(nullptr, {current, next});
+        }
+    }
+
+    void Player::run_output() {
+        trace::set_thread_name("output");
+        std::unique_lock lock(this->mutex);
+
+        while (this->running) {
+            if (this->state != PlayerState::PLAYING) {
+                this->state_changed.wait(lock);
+                continue;
             }
-#if AUDIPI_DEBUG
-            printf("  Audio device buffer size: %ld\n", samples_in_buffer_maybe.value());
-#endif
 
-            if (const auto samples_in_buffer = samples_in_buffer_maybe.value();
-                samples_in_buffer > sufficient_samples) {
-                return;
+            // block on the device outside the lock, the control methods must stay responsive
+            lock.unlock();
+            const auto ready = this->audio_sink->wait_for_space(OUTPUT_WAIT_TIMEOUT_MS);
+            lock.lock();
+
+            if (!ready) {
+                if (this->state == PlayerState::PLAYING) {
+                    this->set_error("Error waiting for the audio device");
+                    this->publish_status();
+                }
+                continue;
             }
-#if AUDIPI_DEBUG
-            printf("  Reading %d samples from buffer\n", sufficient_samples);
-#endif
+            if (!ready.value()) {
+                // timed out without room, e.g. a device that stopped consuming: nothing to write yet
+                continue;
+            }
+
+            const size_t written = this->refill();
+
+            if (written == 0 && this->state == PlayerState::PLAYING && this->is_playlist_written()) {
+                // nothing more will come: sleep until the device has played out what it holds, then stop, rather
+                // than polling a device that always has room
+                const auto timestamp = this->audio_sink->get_timestamp();
+                if (timestamp && timestamp->running && timestamp->delay > 0) {
+                    this->publish_status();
+                    this->state_changed.wait_for(lock, std::chrono::microseconds(
+                                                     timestamp->delay * 1000000 / SAMPLE_RATE + 1));
+                    continue;
+                }
+                this->stop_playback();
+                this->follow_current_track();
+            }
+            this->publish_status();
+
+            if (written == 0 && this->state == PlayerState::PLAYING) {
+                this->state_changed.wait_for(lock, UNDERRUN_BACKOFF);
+            }
+        }
+    }
+
+    void Player::tick() {
+        AUDIPI_TRACE_SPAN("Player::tick");
+        std::lock_guard lg(this->mutex);
 
-            const auto samples_read_maybe = this->tracks[current_track].pop_samples(sufficient_samples);
-            if (!samples_read_maybe) {
+        this->refill();
+        this->publish_status();
+    }
+
+    size_t Player::refill() {
+        if (this->state != PlayerState::PLAYING) {
+            return 0;
+        }
+
+        AUDIPI_TRACE_NAMED_SPAN(span, "Player::refill");
+
+        const auto available_maybe = audio_sink->get_available_samples();
+        if (!available_maybe) {
+            AUDIPI_TRACE_INSTANT("Player::available_error", "error", static_cast<u_int64_t>(-available_maybe.error()));
+            this->set_error("Error reading available space in audio device buffer in refill");
+            return 0;
+        }
+
+        // the device wakes us up once avail_min is free, smaller top-ups only cost wakeups
+        const auto available = available_maybe.value();
+        if (available == 0 || available < audio_sink->get_avail_min()) {
+            return 0;
+        }
+
+        const auto refill_start = std::chrono::steady_clock::now();
+        this->metrics.buffer_fill_samples.observe(audio_sink->get_buffer_size() - std::min(
+                                                      available, audio_sink->get_buffer_size()));
+
+        // hand the device whole runs of cached samples in place, without copying them anywhere on the way
+        size_t written = 0;
+
+        while (written < available) {
+            auto &track = *this->tracks[current_track];
+            const auto samples_maybe = track.peek_samples();
+            if (!samples_maybe) {
                 this->set_error("Error reading samples from track");
-                return;
+                break;
             }
 
-#if AUDIPI_DEBUG
-            printf("  Enqueueing %d samples for playback\n", sufficient_samples);
-#endif
+            const auto samples = samples_maybe.value().first(std::min(samples_maybe.value().size(), available - written));
+            if (samples.empty()) {
+                // the next track continues the same stream, sample for sample
+                if (track.is_finished() && current_track + 1 < tracks.size()) {
+                    this->advance_track();
+                    continue;
+                }
+                break;
+            }
 
-            if (const auto& samples_read = samples_read_maybe.value();
-                const auto enqueue_for_playback_maybe = audio_device.enqueue_for_playback(&samples_read[0], samples_read.size())) {
-#if AUDIPI_DEBUG
-                printf("  Enqueued %ld samples for playback\n", enqueue_for_playback_maybe.value() / 4);
-#endif
-            } else {
-#if AUDIPI_DEBUG
-                printf("  Error enqueuing samples for playback\n");
-#endif
+            const auto enqueue_for_playback_maybe = audio_sink->enqueue_for_playback(samples.data(), samples.size());
+            if (!enqueue_for_playback_maybe) {
+                AUDIPI_TRACE_INSTANT("Player::enqueue_error", "error", static_cast<u_int64_t>(
+                                         -enqueue_for_playback_maybe.error()));
                 this->set_error("Error enqueuing samples for playback");
+                break;
+            }
+
+            if (enqueue_for_playback_maybe.value() < 0) {
+                // a sink must report errors as such, a negative count would wreck the play cursor
+                this->set_error("Audio device returned a negative sample count");
+                break;
+            }
+
+            const auto enqueued = static_cast<size_t>(enqueue_for_playback_maybe.value());
+            track.consume_samples(enqueued);
+            written += enqueued;
+
+            if (enqueued < samples.size()) {
+                break;
             }
         }
+
+        // how long the reader may retry a failed read before the gap would be heard
+        this->tracks[current_track]->set_output_buffered(
+            audio_sink->get_buffer_size() - std::min(available, audio_sink->get_buffer_size()) + written);
+        this->reader.notify();
+
+        this->metrics.tick_duration_us.observe(static_cast<u_int64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - refill_start)
+            .count()));
+
+        AUDIPI_TRACE_SPAN_ARG(span, "samples", written);
+
+        return written;
+    }
+
+    void Player::start_metrics_export(const std::string &path, const std::chrono::milliseconds interval) {
+        this->metrics.start_export(path, interval);
     }
 
     const std::string &Player::get_error_cause() const {
@@ -158,25 +466,93 @@ namespace audipi {
         return state;
     }
 
-    Player::player_status Player::get_status() {
-        if (this->state == PlayerState::ERROR) {
-            return ERROR_PLAYER_STATUS;
+    void Player::publish_status() {
+        player_snapshot snapshot{this->state, this->current_track, {}};
+
+        const auto now = std::chrono::steady_clock::now();
+        playback_anchor anchor{0, 0, now, false};
+        if (!this->tracks.empty() && this->state != PlayerState::ERROR) {
+            const size_t cursor = msfs_location_to_samples(this->tracks[current_track]->get_current_location());
+            anchor = {cursor, cursor, now, false};
+            // while stopped the device holds nothing, only the play cursor counts
+            if (this->state != PlayerState::STOPPED) {
+                if (const auto measured = this->measure_playback()) {
+                    anchor = measured.value();
+                }
+            }
+            snapshot.current_location_in_track = msfs_location{0, 0, 0, 0} + anchor.samples_at(now);
         }
+        this->clock.set(anchor);
 
-        msfs_location current_location = this->tracks[current_track].get_current_location();
+        const player_snapshot previous = this->published_status;
+        if (snapshot == previous) {
+            return;
+        }
+        this->published_status = snapshot;
+        this->status.store(snapshot);
 
-        if (const auto samples_in_buffer = audio_device.get_samples_in_buffer()) {
-            current_location = current_location - samples_in_buffer.value();
-        } else {
-            this->set_error("Error reading sample count in audio device buffer in get_status");
+        if (!this->listener) {
+            return;
+        }
+        if (snapshot.state != previous.state) {
+            this->listener(snapshot.state == PlayerState::ERROR ? status_event::ERROR : status_event::STATE_CHANGED,
+                           snapshot);
+        }
+        if (snapshot.current_track_index != previous.current_track_index) {
+            this->listener(status_event::TRACK_CHANGED, snapshot);
+        }
+    }
+
+    void Player::set_status_listener(status_listener listener) {
+        std::lock_guard lg(this->mutex);
+
+        this->listener = std::move(listener);
+    }
+
+    std::string Player::get_track_name(const size_t track_idx) {
+        std::lock_guard lg(this->mutex);
+
+        if (track_idx >= this->tracks.size()) {
+            return {};
+        }
+        return this->tracks[track_idx]->get_track_name();
+    }
+
+    Player::player_status Player::get_status() {
+        const auto snapshot = this->get_snapshot();
+        if (snapshot.state == PlayerState::ERROR) {
             return ERROR_PLAYER_STATUS;
         }
 
         return {
-            .state = this->state,
-            .current_track_index = this->current_track,
-            .current_track_name = this->tracks[current_track].get_track_name(),
-            .current_location_in_track = current_location
+            .state = snapshot.state,
+            .current_track_index = snapshot.current_track_index,
+            .current_track_name = this->get_track_name(snapshot.current_track_index),
+            .current_location_in_track = snapshot.current_location_in_track
+        };
+    }
+
+    std::expected<playback_anchor, std::string> Player::measure_playback() {
+        const size_t cursor = msfs_location_to_samples(this->tracks[current_track]->get_current_location());
+
+        const auto timestamp = audio_sink->get_timestamp();
+        if (!timestamp) {
+            return std::unexpected("Error reading audio device status: "
+                                   + this->audio_sink->render_error(timestamp.error()));
+        }
+
+        // right after a gapless advance, the device is still playing the end of the previous track
+        const size_t delay = std::min(static_cast<size_t>(timestamp->delay), cursor);
+        return playback_anchor{
+            cursor - delay, cursor, timestamp->time, timestamp->running && this->state == PlayerState::PLAYING
         };
     }
+
+    std::expected<msfs_location, std::string> Player::get_heard_location() {
+        const auto anchor = this->measure_playback();
+        if (!anchor) {
+            return std::unexpected(anchor.error());
+        }
+        return msfs_location{0, 0, 0, 0} + anchor->samples_at(std::chrono::steady_clock::now());
+    }
 }
@@ -2,12 +2,23 @@
 #define PLAYER_H
 
 #include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
 #include <thread>
 
 #include "AudioDevice.h"
 #include "CdRom.h"
+#include "ImagePlayerTrack.h"
+#include "PersistentCache.h"
+#include "PlaybackClock.h"
+#include "PlayerMetrics.h"
 #include "PlayerTrack.h"
 #include "SampleBuffer.h"
+#include "SeqLock.h"
+#include "SpeedGovernor.h"
+#include "TrackReader.h"
 #include "structs.h"
 
 namespace audipi {
@@ -18,15 +29,94 @@ namespace audipi {
         ERROR
     };
 
+    enum class status_event {
+        STATE_CHANGED,
+        TRACK_CHANGED,
+        ERROR
+    };
+
+    /**
+    * @brief What the player is doing, as last published by it. Cheap to copy and compare, so that front ends can
+    * redraw only when it changes.
+    */
+    struct player_snapshot {
+        PlayerState state;
+        size_t current_track_index;
+        msf_location current_location_in_track;
+
+        bool operator==(const player_snapshot &) const = default;
+    };
+
+    /**
+    * @brief Called by the player when a status_event happens, from whichever thread caused it and with the player
+    * locked: it must not call back into the player, only hand the snapshot over to the front end.
+    */
+    using status_listener = std::function<void(status_event event, const player_snapshot &snapshot)>;
+
+    constexpr unsigned int DEFAULT_READ_AHEAD_SECONDS = 5;
+    constexpr size_t DEFAULT_CACHE_BYTES = 32UL * 1024 * 1024;
+    constexpr size_t DEFAULT_PERSISTENT_CACHE_BYTES = 2000UL * 1024 * 1024;
+
     class Player {
-        AudioDevice audio_device;
-        std::vector<CdPlayerTrack> tracks; // todo generalize to PlayerTrack
+        PlayerMetrics metrics; // declared first, everything else reports into it
+        std::unique_ptr<AudioSink> audio_sink;
+        std::vector<std::unique_ptr<SpeedGovernor>> speed_governors; // one per disc, used by its tracks
+        std::vector<std::unique_ptr<PlayerTrack>> tracks;
+        TrackReader reader; // declared after tracks, so that it stops before they are destroyed
         size_t current_track{};
-        PlayerState state = PlayerState::STOPPED;
+        std::atomic<PlayerState> state = PlayerState::STOPPED;
         std::string error_cause;
 
+        size_t cache_bytes = DEFAULT_CACHE_BYTES;
+        subchannel_mode subchannel_polling = subchannel_mode::none;
+        read_mode reading_mode = read_mode::fast;
+        std::optional<speed_governor_config> speed_control; // nullopt while speed control is off
+        std::string persistent_cache_directory; // empty while the persistent cache is off
+        size_t persistent_cache_bytes = DEFAULT_PERSISTENT_CACHE_BYTES;
+
+        // guards the playlist and the audio device between the control methods and the output thread
+        std::mutex mutex;
+        std::condition_variable state_changed;
+        bool running = true;
+
+        // written under mutex, read lock-free by front ends
+        SeqLock<player_snapshot> status;
+        player_snapshot published_status{PlayerState::STOPPED, 0, {}};
+        PlaybackClock clock;
+        status_listener listener;
+        std::thread output_thread; // declared last, so that everything it uses exists when it starts
+
         void set_error(const char* error);
 
+        void run_output();
+
+        // writes as many samples as the audio device can take, returns how many were written
+        size_t refill();
+
+        void stop_playback();
+
+        // whether the last track was written to the audio device to its end
+        [[nodiscard]] bool is_playlist_written() const;
+
+        void switch_track(size_t track_idx);
+
+        // moves on to the next track without touching the audio device, its queue was pre-rolled by the reader
+        void advance_track();
+
+        // points the read-ahead thread at the current track and its neighbours
+        void follow_current_track();
+
+        // where in the current track the device is, behind the play cursor by the delay of the device
+        std::expected<playback_anchor, std::string> measure_playback();
+
+        // location in the current track of the sample being heard
+        std::expected<msfs_location, std::string> get_heard_location();
+
+        std::expected<void, std::string> seek_current_track(const msfs_location &location);
+
+        // publishes a new snapshot if anything changed, and tells the listener about it
+        void publish_status();
+
     public:
         struct player_status {
             PlayerState state;
@@ -35,12 +125,29 @@ namespace audipi {
             msf_location current_location_in_track;
         };
 
-        Player();
+        explicit Player(unsigned int read_ahead_seconds = DEFAULT_READ_AHEAD_SECONDS,
+                        const audio_device_config &audio_config = {});
+
+        /**
+        * @brief Plays into sink rather than an ALSA device, e.g. a NullSink to run without a sound card.
+        */
+        explicit Player(std::unique_ptr<AudioSink> sink, unsigned int read_ahead_seconds = DEFAULT_READ_AHEAD_SECONDS);
+        ~Player();
+
+        Player(const Player &) = delete;
+        Player &operator=(const Player &) = delete;
 
         [[nodiscard]] bool is_init() const; // todo replace with get player status
 
         void enqueue_cd(CdRom &cd_rom, const disk_toc &toc);
 
+        /**
+        * @brief Enqueues the tracks of a .cue or .wav disc image, played without a drive.
+        */
+        std::expected<void, std::string> enqueue_image(const std::string &path);
+
+        void enqueue_track(std::unique_ptr<PlayerTrack> track);
+
         void play();
 
         void pause();
@@ -53,14 +160,103 @@ namespace audipi {
 
         std::expected<void, std::string> jump_to_track(size_t track_idx);
 
+        /**
+        * @brief Moves playback to location in the current track, sample-accurately. Cached audio plays right away;
+        * otherwise a single batch is read at location before the read-ahead thread takes over.
+        */
+        std::expected<void, std::string> seek(const msfs_location &location);
+
+        /**
+        * @brief Moves playback by offset_samples from the sample being heard, within the current track.
+        */
+        std::expected<void, std::string> seek_relative(long offset_samples);
+
         void clear_playlist();
 
+        void set_read_ahead_seconds(unsigned int seconds);
+
+        /**
+        * @brief Sets how much memory the frame cache of each disc enqueued from now on may take.
+        */
+        void set_cache_bytes(size_t max_bytes);
+
+        /**
+        * @brief Sets whether discs enqueued from now on poll the Q subchannel while reading.
+        */
+        void set_subchannel_mode(subchannel_mode mode);
+
+        /**
+        * @brief Sets whether discs enqueued from now on are read securely, verifying every frame against a second read.
+        */
+        void set_read_mode(read_mode mode);
+
+        /**
+        * @brief Sets how discs enqueued from now on adapt the drive speed to the read-ahead, nullopt to leave the
+        * drive at its default speed. Off by default, as it sends CDROM_SELECT_SPEED to the drive.
+        */
+        void set_speed_control(const std::optional<speed_governor_config> &config);
+
+        /**
+        * @brief Sets where discs enqueued from now on keep their frames across plays, and how much space all discs
+        * may take together. Off by default; an empty directory turns it off again.
+        * PersistentCache::default_directory() and DEFAULT_PERSISTENT_CACHE_BYTES are the usual choice.
+        */
+        void set_persistent_cache(const std::string &directory, size_t max_bytes);
+
+        /**
+        * @brief Refills the audio device once. Playback is driven by the player's own output thread,
+        * which calls this whenever the device needs a period; front ends do not need to.
+        */
         void tick();
 
         [[nodiscard]] const std::string& get_error_cause() const;
 
+        [[nodiscard]] const PlayerMetrics &get_metrics() const {
+            return metrics;
+        }
+
+        /**
+        * @brief Writes the metrics to path in Prometheus text format every interval, from a background thread.
+        */
+        void start_metrics_export(const std::string &path, std::chrono::milliseconds interval);
+
         [[nodiscard]] PlayerState get_state() const;
 
+        /**
+        * @brief Last published snapshot. Lock-free and allocation-free, and never touches the audio device, so that
+        * front ends can call it as often as they redraw.
+        */
+        [[nodiscard]] player_snapshot get_snapshot() const {
+            return status.load();
+        }
+
+        /**
+        * @brief Number of snapshots published so far: the snapshot can only differ from a previous one if it changed.
+        */
+        [[nodiscard]] u_int64_t get_status_version() const {
+            return status.version();
+        }
+
+        /**
+        * @brief Location in the current track of the sample being heard right now, interpolated from the timestamp
+        * the audio device gave at the last refill. Lock-free and never touches the audio device, like
+        * get_snapshot(), but precise to the sample however long ago the snapshot was published.
+        */
+        [[nodiscard]] msfs_location get_position() const {
+            return clock.location_at(std::chrono::steady_clock::now());
+        }
+
+        [[nodiscard]] std::string get_track_name(size_t track_idx);
+
+        /**
+        * @brief Sets the function told about state changes, track changes and errors, replacing the previous one.
+        */
+        void set_status_listener(status_listener listener);
+
+        /**
+        * @brief Snapshot plus the name of the current track. Takes the player lock for the name; front ends
+        * redrawing often should use get_snapshot() and only fetch the name when the track changes.
+        */
         player_status get_status();
     };
 }
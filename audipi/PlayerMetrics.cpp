@@ -0,0 +1,154 @@
+#include "PlayerMetrics.h"
+
+#include <cerrno>
+#include <cstdio>
+
+#include "Trace.h"
+
+namespace audipi {
+    Histogram::Histogram(const std::array<u_int64_t, HISTOGRAM_BUCKETS> &upper_bounds) : upper_bounds(upper_bounds) {
+    }
+
+    void Histogram::observe(const u_int64_t value) {
+        size_t bucket = 0;
+        while (bucket < HISTOGRAM_BUCKETS && value > this->upper_bounds[bucket]) {
+            ++bucket;
+        }
+        this->buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        this->sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    u_int64_t Histogram::get_count() const {
+        u_int64_t count = 0;
+        for (const auto &bucket: this->buckets) {
+            count += bucket.load(std::memory_order_relaxed);
+        }
+        return count;
+    }
+
+    void Histogram::write_prometheus(std::ostringstream &out, const char *name, const char *help) const {
+        out << "# HELP " << name << " " << help << "\n"
+                << "# TYPE " << name << " histogram\n";
+
+        u_int64_t cumulative = 0;
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+            cumulative += this->buckets[i].load(std::memory_order_relaxed);
+            out << name << "_bucket{le=\"" << this->upper_bounds[i] << "\"} " << cumulative << "\n";
+        }
+        cumulative += this->buckets[HISTOGRAM_BUCKETS].load(std::memory_order_relaxed);
+        out << name << "_bucket{le=\"+Inf\"} " << cumulative << "\n"
+                << name << "_sum " << this->get_sum() << "\n"
+                << name << "_count " << cumulative << "\n";
+    }
+
+    PlayerMetrics::PlayerMetrics()
+        : read_latency_us({250, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000}),
+          buffer_fill_samples({256, 512, 1024, 2048, 4096, 8192, 16384, 32768, 65536, 131072, 262144, 524288}),
+          tick_duration_us({10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000}) {
+    }
+
+    PlayerMetrics::~PlayerMetrics() {
+        this->stop_export();
+    }
+
+    std::string PlayerMetrics::to_prometheus() const {
+        std::ostringstream out;
+
+        const auto counter = [&out](const char *name, const char *help, const std::atomic<u_int64_t> &value) {
+            out << "# HELP " << name << " " << help << "\n"
+                    << "# TYPE " << name << " counter\n"
+                    << name << " " << value.load(std::memory_order_relaxed) << "\n";
+        };
+
+        counter("audipi_xruns_total", "Audio device underruns recovered from.", this->xruns);
+        counter("audipi_frames_read_total", "Audio frames read from the drive.", this->frames_read);
+        counter("audipi_cache_hits_total", "Frames found in the cache when queued for playback.", this->cache_hits);
+        counter("audipi_cache_misses_total", "Frames that had to be read from the drive when queued for playback.",
+                this->cache_misses);
+        counter("audipi_secure_rereads_total", "Extra passes secure reads needed until two reads agreed.",
+                this->secure_rereads);
+        counter("audipi_unverified_frames_total", "Frames secure reads could not get two matching reads of.",
+                this->unverified_frames);
+        counter("audipi_jitter_corrections_total", "Secure reads the drive misplaced and that were realigned.",
+                this->jitter_corrections);
+        counter("audipi_c2_damaged_reads_total", "Reads of a frame the drive flagged as uncorrectable with C2 errors.",
+                this->c2_damaged_reads);
+        counter("audipi_read_retries_total", "Failed drive reads of a frame playback was waiting for, retried.",
+                this->read_retries);
+        counter("audipi_concealed_frames_total", "Frames that could not be read in time and were interpolated.",
+                this->concealed_frames);
+        counter("audipi_drive_speed_changes_total", "Drive speeds selected.", this->speed_changes);
+        out << "# HELP audipi_drive_speed Drive speed selected last, in multiples of 1x, 0 for the maximum.\n"
+                << "# TYPE audipi_drive_speed gauge\n"
+                << "audipi_drive_speed " << this->drive_speed.load(std::memory_order_relaxed) << "\n";
+
+        this->read_latency_us.write_prometheus(out, "audipi_cd_read_latency_microseconds",
+                                               "Duration of each read command sent to the drive.");
+        this->buffer_fill_samples.write_prometheus(out, "audipi_buffer_fill_samples",
+                                                   "Samples queued in the audio device, at each refill.");
+        this->tick_duration_us.write_prometheus(out, "audipi_tick_duration_microseconds",
+                                                "Duration of each refill of the audio device.");
+
+        return out.str();
+    }
+
+    std::expected<void, int> PlayerMetrics::write_prometheus(const std::string &path) const {
+        const std::string contents = this->to_prometheus();
+        const std::string temporary_path = path + ".tmp";
+
+        FILE *file = fopen(temporary_path.c_str(), "w");
+        if (file == nullptr) {
+            return std::unexpected(errno);
+        }
+
+        const bool written = fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+        const int error = errno;
+        if (fclose(file) != 0 || !written) {
+            remove(temporary_path.c_str());
+            return std::unexpected(written ? errno : error);
+        }
+
+        // readers never see a half-written file
+        if (rename(temporary_path.c_str(), path.c_str()) != 0) {
+            return std::unexpected(errno);
+        }
+        return {};
+    }
+
+    void PlayerMetrics::start_export(const std::string &path, const std::chrono::milliseconds interval) {
+        this->stop_export();
+
+        std::lock_guard lg(this->export_mutex);
+        this->exporting = true;
+        this->export_thread = std::thread(&PlayerMetrics::run_export, this, path, interval);
+    }
+
+    void PlayerMetrics::stop_export() {
+        {
+            std::lock_guard lg(this->export_mutex);
+            this->exporting = false;
+        }
+        this->export_wakeup.notify_all();
+
+        if (this->export_thread.joinable()) {
+            this->export_thread.join();
+        }
+    }
+
+    void PlayerMetrics::run_export(const std::string path, const std::chrono::milliseconds interval) {
+        trace::set_thread_name("metrics export");
+        std::unique_lock lock(this->export_mutex);
+
+        while (this->exporting) {
+            lock.unlock();
+            if (const auto result = this->write_prometheus(path); !result) {
+#if AUDIPI_DEBUG
+                printf("Cannot write metrics to %s: %d\n", path.c_str(), result.error());
+#endif
+            }
+            lock.lock();
+
+            this->export_wakeup.wait_for(lock, interval, [this] { return !this->exporting; });
+        }
+    }
+}
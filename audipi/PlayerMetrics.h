@@ -0,0 +1,94 @@
+#ifndef PLAYERMETRICS_H
+#define PLAYERMETRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <expected>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace audipi {
+    constexpr size_t HISTOGRAM_BUCKETS = 12;
+
+    /**
+    * @brief Lock-free histogram with fixed bucket bounds, cheap enough to observe from the playback path.
+    */
+    class Histogram {
+        std::array<u_int64_t, HISTOGRAM_BUCKETS> upper_bounds;
+        std::array<std::atomic<u_int64_t>, HISTOGRAM_BUCKETS + 1> buckets{}; // the last one is +Inf
+        std::atomic<u_int64_t> sum{0};
+
+    public:
+        explicit Histogram(const std::array<u_int64_t, HISTOGRAM_BUCKETS> &upper_bounds);
+
+        void observe(u_int64_t value);
+
+        [[nodiscard]] u_int64_t get_count() const;
+
+        [[nodiscard]] u_int64_t get_sum() const {
+            return sum.load(std::memory_order_relaxed);
+        }
+
+        /**
+        * @brief Appends the histogram in Prometheus text format, with cumulative buckets.
+        */
+        void write_prometheus(std::ostringstream &out, const char *name, const char *help) const;
+    };
+
+    /**
+    * @brief Counters and histograms describing how playback is going, updated lock-free by the player's threads.
+    * Can be dumped periodically to a file in Prometheus text format, e.g. for node_exporter's textfile collector.
+    */
+    class PlayerMetrics {
+        std::mutex export_mutex;
+        std::condition_variable export_wakeup;
+        bool exporting = false;
+        std::thread export_thread;
+
+        void run_export(std::string path, std::chrono::milliseconds interval);
+
+    public:
+        std::atomic<u_int64_t> xruns{0};
+        std::atomic<u_int64_t> frames_read{0}; // from the drive
+        std::atomic<u_int64_t> cache_hits{0}; // frames the playback queue found in the cache
+        std::atomic<u_int64_t> cache_misses{0}; // frames the playback queue had to wait for the drive for
+        std::atomic<u_int64_t> secure_rereads{0}; // extra passes secure reads needed to verify a batch
+        std::atomic<u_int64_t> unverified_frames{0}; // frames secure reads gave up verifying
+        std::atomic<u_int64_t> jitter_corrections{0}; // secure reads the drive misplaced
+        std::atomic<u_int64_t> c2_damaged_reads{0}; // reads of a frame the drive flagged with C2 errors
+        std::atomic<u_int64_t> read_retries{0}; // failed reads of a frame playback was waiting for, retried
+        std::atomic<u_int64_t> concealed_frames{0}; // frames that could not be read in time, made up instead
+        std::atomic<u_int64_t> speed_changes{0}; // drive speeds selected
+        std::atomic<u_int64_t> drive_speed{0}; // selected last, 0 for the drive's maximum
+
+        Histogram read_latency_us; // per read command sent to the drive
+        Histogram buffer_fill_samples; // audio device buffer fill level, at each refill
+        Histogram tick_duration_us; // per refill of the audio device
+
+        PlayerMetrics();
+        ~PlayerMetrics();
+
+        PlayerMetrics(const PlayerMetrics &) = delete;
+        PlayerMetrics &operator=(const PlayerMetrics &) = delete;
+
+        [[nodiscard]] std::string to_prometheus() const;
+
+        /**
+        * @brief Writes to_prometheus() to path, atomically replacing the previous contents.
+        */
+        [[nodiscard]] std::expected<void, int> write_prometheus(const std::string &path) const;
+
+        /**
+        * @brief Starts (or restarts) writing the metrics to path every interval, from a background thread.
+        */
+        void start_export(const std::string &path, std::chrono::milliseconds interval);
+
+        void stop_export();
+    };
+}
+
+#endif //PLAYERMETRICS_H
@@ -1,115 +1,489 @@
 #include "PlayerTrack.h"
 
-#if AUDIPI_DEBUG
-#include <cstdio>
-#endif
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
 
+#include "Trace.h"
 #include "util.h"
 
-namespace audipi {
-    CdPlayerTrack::CdPlayerTrack(CdRom &cd_rom, const disk_toc_entry &track)
-        : cd_rom(cd_rom), buffer(30*75), track(track), current_location{0, 0, 0, 0} {
+// frames fetched per CDROMREADAUDIO, a third of a second of audio
+constexpr size_t READ_BATCH_FRAMES = 25;
+// frames decoded ahead of playback in the lock-free queue, the rest of the read-ahead stays in the cache
+constexpr size_t QUEUE_FRAMES = 75;
+// read-ahead this close to the play cursor means playback is about to run dry
+constexpr size_t STARVING_FRAMES = QUEUE_FRAMES / 4;
+// kept out of the retry budget of a failed read, for the reader to read the frame after it, conceal the frame and
+// queue it in time
+constexpr auto CONCEAL_MARGIN = std::chrono::milliseconds(50);
+// pause between two reads of a frame that keeps failing, as long as the retry budget allows
+constexpr auto RETRY_INTERVAL = std::chrono::milliseconds(10);
+
+namespace {
+    int16_t get_channel(const audipi::sample_data &sample, const size_t channel) {
+        int16_t value;
+        std::memcpy(&value, sample.data + channel * sizeof(value), sizeof(value));
+        return value;
+    }
+
+    void set_channel(audipi::sample_data &sample, const size_t channel, const int16_t value) {
+        std::memcpy(sample.data + channel * sizeof(value), &value, sizeof(value));
     }
 
-    CdPlayerTrack::CdPlayerTrack(const CdPlayerTrack &other) = default;
+    // errors that no amount of retrying will get past
+    bool is_fatal_read_error(const int error) {
+        return error == ENOMEDIUM || error == ENODEV;
+    }
+}
+
+namespace audipi {
+    CdPlayerTrack::CdPlayerTrack(CdRom &cd_rom, const disk_toc_entry &track, std::shared_ptr<SampleBuffer> buffer,
+                                 std::shared_ptr<PersistentCache> persistent_cache)
+        : cd_rom(cd_rom), buffer(std::move(buffer)), track(track), start_frame(msf_location_to_frames(track.address)),
+          persistent_cache(std::move(persistent_cache)),
+          current_location{0, 0, 0, 0}, current_frame(0), queue(QUEUE_FRAMES), next_queued_frame(0), read_error(0),
+          read_batch_buffer(READ_BATCH_FRAMES * CD_FRAMESIZE_RAW), read_batch_c2(READ_BATCH_FRAMES * CD_C2_BYTES),
+          secure_reader(cd_rom) {
+    }
 
     void CdPlayerTrack::reset() {
-        this->current_location = {0, 0, 0, 0}; }
+        this->buffer->release(this);
+        this->playing = false;
+        this->current_location = {0, 0, 0, 0};
+        this->current_frame = 0;
+        this->queue.clear();
+        this->next_queued_frame = 0;
+        this->read_error = 0;
+        this->retried_frame = static_cast<size_t>(-1);
+    }
+
+    std::expected<void, int> CdPlayerTrack::seek(const msfs_location &location) {
+        const size_t track_frames = msf_location_to_frames(track.duration);
+        const size_t target = std::min(msfs_location_to_samples(location), track_frames * SAMPLES_IN_FRAME);
+
+        this->current_location = msfs_location{0, 0, 0, 0} + target;
+        this->current_frame = target / SAMPLES_IN_FRAME;
+        this->queue.clear();
+        this->next_queued_frame = this->current_frame;
+        this->read_error = 0;
+
+        if (is_finished()) {
+            return {};
+        }
+
+        if (!buffer->has_frame(start_frame + next_queued_frame)) {
+            if (const auto result = read_batch(next_queued_frame, track_frames); !result) {
+                return std::unexpected(result.error());
+            }
+        }
+
+        // hand over whatever is already cached, the read-ahead thread takes it from the first miss
+        while (next_queued_frame < track_frames && queue_cached_frame()) {
+        }
+
+        return {};
+    }
 
     std::string CdPlayerTrack::get_track_name() const {
         return std::string("CD Track ") + left_pad_string(std::to_string(this->track.track_num), 2, '0');
     }
 
-    template<size_t array_size, typename = std::enable_if_t<array_size % 4 == 0>>
-    std::array<sample_data, array_size / 4> copy_from(const std::array<u_int8_t, array_size> &data) {
-        std::array<sample_data, array_size / 4> samples{};
+    std::expected<std::span<const sample_data>, int> CdPlayerTrack::peek_samples() {
+        AUDIPI_TRACE_SPAN("CdPlayerTrack::peek_samples");
 
-        for (size_t i = 0; i < array_size; i += 4) {
-            samples[i / 4] = sample_data{data[i], data[i + 1], data[i + 2], data[i + 3]};
+        const queued_frame *frame = queue.front();
+        if (frame == nullptr) {
+            // the read-ahead thread has not caught up
+            AUDIPI_TRACE_INSTANT("CdPlayerTrack::queue_empty", "frame", current_frame.load());
+            if (const int error = read_error.load(); error != 0) {
+                return std::unexpected(error);
+            }
+            return {};
         }
 
-        return samples;
+        return std::span(frame->samples).subspan(current_location.samples);
     }
 
-    std::expected<std::vector<sample_data>, int> CdPlayerTrack::pop_samples(const size_t num_samples) {
-        std::vector<sample_data> samples;
+    void CdPlayerTrack::consume_samples(const size_t num_samples) {
+        if (num_samples == 0) {
+            return;
+        }
 
-        size_t samples_to_fetch = num_samples;
+        current_location += num_samples;
 
-        while (samples_to_fetch > 0) {
-#if AUDIPI_DEBUG
-            printf("%lu samples left to fetch\n", samples_to_fetch);
-#endif
+        if (current_location.samples == 0) {
+            queue.pop();
+            current_frame = msf_location_to_frames(current_location);
+        }
+    }
 
-            const auto num_to_fetch = samples_to_fetch > SAMPLES_IN_FRAME - current_location.samples
-                    ? SAMPLES_IN_FRAME - current_location.samples
-                    : samples_to_fetch;
+    void CdPlayerTrack::prefetch_samples(const size_t num_samples) {
+        const size_t first_frame = current_frame;
+        const size_t end_frame = std::min(first_frame + (num_samples + SAMPLES_IN_FRAME - 1) / SAMPLES_IN_FRAME,
+                                          msf_location_to_frames(track.duration));
+        AUDIPI_TRACE_NAMED_SPAN(span, "CdPlayerTrack::prefetch_samples");
+        AUDIPI_TRACE_SPAN_ARG(span, "samples", num_samples);
 
-#if AUDIPI_DEBUG
-            printf("  Fetching %lu samples\n", num_to_fetch);
-            printf("  From location %s\n", msfs_location_to_string(current_location).c_str());
-#endif
+        for (size_t frame = first_frame; frame < end_frame;) {
+            if (buffer->has_frame(start_frame + frame)) {
+                ++frame;
+                continue;
+            }
 
-            if (buffer.has_frame(current_location)) {
+            const auto result = read_batch(frame, end_frame);
+            if (!result) {
+                break;
+            }
+            frame += result.value();
+        }
+    }
 
-#if AUDIPI_DEBUG
-                printf("  Cache hit!\n");
-#endif
+    std::expected<bool, int> CdPlayerTrack::read_ahead(const size_t frames_ahead) {
+        const size_t track_frames = msf_location_to_frames(track.duration);
+        const size_t end_frame = std::min(current_frame + frames_ahead, track_frames);
 
-                const auto frame_data = buffer.read_frame(current_location);
+        // the cache is shared with the rest of the disc: keep what this track is about to play from being evicted,
+        // next to the window of the track playing before it while it is only being pre-rolled
+        buffer->protect(playing ? window_role::current : window_role::following, this,
+                        start_frame + next_queued_frame, start_frame + end_frame, NEIGHBOUR_PREFETCH_FRAMES);
 
-                samples.insert(samples.end(),
-                    std::make_move_iterator(frame_data.begin() + current_location.samples),
-                    std::make_move_iterator(frame_data.begin() + current_location.samples + num_to_fetch));
+        // feeding the playback queue comes first, the cache only matters once the queue is full
+        if (next_queued_frame < track_frames) {
+            if (queue.producer_slot() != nullptr) {
+                const size_t frame = next_queued_frame;
+                if (queue_cached_frame()) {
+                    if (metrics != nullptr && frame != missed_frame) {
+                        metrics->cache_hits.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    return true;
+                }
 
-            } else {
+                if (metrics != nullptr && frame != missed_frame) {
+                    metrics->cache_misses.fetch_add(1, std::memory_order_relaxed);
+                }
+                missed_frame = frame;
+                report_fill(frame, frames_ahead);
+                return read_missing(next_queued_frame, std::max(end_frame, next_queued_frame + 1));
+            }
+        }
+
+        for (size_t frame = next_queued_frame; frame < end_frame; ++frame) {
+            if (!buffer->has_frame(start_frame + frame)) {
+                report_fill(frame, frames_ahead);
+                return read_missing(frame, end_frame);
+            }
+        }
 
-#if AUDIPI_DEBUG
-                printf("  Cache miss, reading from CD\n");
-#endif
+        // everything up to the target, or to the end of the track, is ready
+        report_fill(current_frame + frames_ahead, frames_ahead);
+        return false;
+    }
 
-                if (auto result = cd_rom.read_frame(current_location + track.address)) {
-                    auto frame_samples = copy_from(result.value().raw_data);
-                    buffer.add_frame(current_location, frame_samples);
+    std::expected<bool, int> CdPlayerTrack::prefetch_start(const size_t frames) {
+        const size_t end_frame = std::min(frames, msf_location_to_frames(track.duration));
 
-                    samples.insert(samples.end(),
-                        std::make_move_iterator(frame_samples.begin() + current_location.samples),
-                        std::make_move_iterator(frame_samples.begin() + current_location.samples + num_to_fetch));
-                } else {
+        for (size_t frame = 0; frame < end_frame; ++frame) {
+            if (!buffer->has_frame(start_frame + frame)) {
+                if (const auto result = read_batch(frame, end_frame); !result) {
                     return std::unexpected(result.error());
                 }
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool CdPlayerTrack::queue_cached_frame() {
+        queued_frame *slot = queue.producer_slot();
+        if (slot == nullptr || !buffer->read_frame(start_frame + next_queued_frame, slot->samples)) {
+            return false;
+        }
+        slot->frame = next_queued_frame;
+        queue.push();
+        ++next_queued_frame;
+        return true;
+    }
+
+    std::expected<bool, int> CdPlayerTrack::read_missing(const size_t first_frame, const size_t end_frame) {
+        // only the frame the playback queue is waiting for is urgent, the rest is read again when it becomes so
+        const bool urgent = first_frame == next_queued_frame;
+        // once it failed, it is read on its own, so that its batch does not fail with it
+        const bool retrying = urgent && retried_frame == first_frame;
+
+        const auto result = read_batch(first_frame, retrying ? first_frame + 1 : end_frame);
+        if (result) {
+            if (urgent) {
+                retried_frame = static_cast<size_t>(-1);
+            }
+            read_error = 0;
+            return true;
+        }
+
+        if (is_fatal_read_error(result.error())) {
+            read_error = result.error();
+            return std::unexpected(result.error());
+        }
+        if (!urgent) {
+            return std::unexpected(result.error());
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (!retrying) {
+            retried_frame = first_frame;
+            retry_deadline = now + playout_budget();
+        }
+        if (now < retry_deadline) {
+            // the reader tries again after get_retry_delay()
+            AUDIPI_TRACE_INSTANT("CdPlayerTrack::read_retry", "frame", first_frame);
+            if (metrics != nullptr) {
+                metrics->read_retries.fetch_add(1, std::memory_order_relaxed);
+            }
+            return std::unexpected(result.error());
+        }
+
+        // out of time: keep playing over the gap rather than stopping, bridged to the frame after it if that reads
+        if (first_frame + 1 < msf_location_to_frames(track.duration)) {
+            if (const auto next = read_batch(first_frame + 1, first_frame + 2); !next) {
+                AUDIPI_TRACE_INSTANT("CdPlayerTrack::conceal_next_error", "error", next.error());
             }
+        }
+        conceal_frame(first_frame);
+        retried_frame = static_cast<size_t>(-1);
+        return true;
+    }
 
-            current_location += num_to_fetch;
-            samples_to_fetch -= num_to_fetch;
+    std::chrono::microseconds CdPlayerTrack::get_retry_delay() const {
+        if (retried_frame == static_cast<size_t>(-1)) {
+            return PlayerTrack::get_retry_delay();
         }
+        const auto left = std::chrono::duration_cast<std::chrono::microseconds>(
+            retry_deadline - std::chrono::steady_clock::now());
+        return std::clamp(left, std::chrono::microseconds(0),
+                          std::chrono::duration_cast<std::chrono::microseconds>(RETRY_INTERVAL));
+    }
 
-        return samples;
+    std::chrono::microseconds CdPlayerTrack::playout_budget() const {
+        const size_t samples = queue.size() * SAMPLES_IN_FRAME + output_buffered.load(std::memory_order_relaxed);
+        const auto playout = std::chrono::microseconds(samples * 1000000 / (SAMPLES_IN_FRAME * CD_FRAMES));
+        return std::max(playout - std::chrono::duration_cast<std::chrono::microseconds>(CONCEAL_MARGIN),
+                        std::chrono::microseconds(0));
     }
 
-    void CdPlayerTrack::prefetch_samples(const size_t num_samples) {
-        size_t samples_to_fetch = num_samples;
-        msf_location location = current_location;
-#if AUDIPI_DEBUG
-        printf("Prefetching %ld samples\n", samples_to_fetch);
-#endif
-
-        while (samples_to_fetch > 0) {
-            if (!buffer.has_frame(location)) {
-                if (auto result = cd_rom.read_frame(location + track.address)) {
-                    auto frame_samples = copy_from(result.value().raw_data);
-                    buffer.add_frame(location, frame_samples);
-
-#if AUDIPI_DEBUG
-                    printf("  Added frame %d:%d:%d to cache\n", location.minute, location.second, location.frame);
-#endif
-                } else {
+    void CdPlayerTrack::conceal_frame(const size_t frame) {
+        AUDIPI_TRACE_INSTANT("CdPlayerTrack::conceal_frame", "frame", frame);
+
+        // the samples either side of the gap: the frame after it is only known if it could be read, the frame
+        // before it is left in concealed_samples, silence if it is not known
+        std::optional<sample_data> after;
+        if (frame + 1 < msf_location_to_frames(track.duration)
+            && buffer->read_frame(start_frame + frame + 1, concealed_samples)) {
+            after = concealed_samples.front();
+        }
+        if (frame == 0 || !buffer->read_frame(start_frame + frame - 1, concealed_samples)) {
+            concealed_samples.fill({});
+        }
+        const sample_data before = concealed_samples.back();
+
+        // what the drive made of the frame, if it told which samples it got wrong
+        std::lock_guard lg(this->read_mutex);
+        const bool partial = damaged_frame == frame;
+        if (partial) {
+            concealed_samples = damaged_samples;
+        }
+
+        // each run of bad samples is bridged between the good ones around it, or holds the last good one where
+        // nothing follows it; a whole frame with nothing after it repeats the frame before it instead
+        for (size_t first = 0; (partial || after) && first < SAMPLES_IN_FRAME;) {
+            if (partial && !is_sample_damaged(damaged_c2.data(), first)) {
+                ++first;
+                continue;
+            }
+            size_t end = first + 1;
+            while (end < SAMPLES_IN_FRAME && (!partial || is_sample_damaged(damaged_c2.data(), end))) {
+                ++end;
+            }
+
+            const sample_data from = first > 0 ? concealed_samples[first - 1] : before;
+            const sample_data to = end < SAMPLES_IN_FRAME ? concealed_samples[end] : after.value_or(from);
+            const long total = static_cast<long>(end - first + 1);
+            for (size_t i = first; i < end; ++i) {
+                const long weight = static_cast<long>(i - first + 1);
+                for (size_t channel = 0; channel < 2; ++channel) {
+                    const long from_value = get_channel(from, channel);
+                    const long to_value = get_channel(to, channel);
+                    set_channel(concealed_samples[i], channel,
+                                static_cast<int16_t>(from_value + (to_value - from_value) * weight / total));
+                }
+            }
+            first = end;
+        }
+
+        // through the cache like any other frame, but never into the persistent cache
+        buffer->add_frame(start_frame + frame, concealed_samples);
+        if (metrics != nullptr) {
+            metrics->concealed_frames.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void CdPlayerTrack::report_fill(const size_t ready_end_frame, const size_t frames_ahead) const {
+        // a track pre-rolled behind the playing one is never short of time
+        if (speed_governor == nullptr || !playing) {
+            return;
+        }
+        const size_t played = current_frame;
+        const size_t fill = ready_end_frame > played ? ready_end_frame - played : 0;
+        speed_governor->update(fill, frames_ahead, fill < STARVING_FRAMES);
+    }
+
+    void CdPlayerTrack::set_speed_governor(SpeedGovernor *governor) {
+        this->speed_governor = governor;
+    }
+
+    void CdPlayerTrack::set_output_buffered(const size_t samples) {
+        output_buffered.store(samples, std::memory_order_relaxed);
+        playing.store(true, std::memory_order_relaxed);
+    }
+
+    std::expected<void, int> CdPlayerTrack::read_from_drive(const size_t first_frame, const size_t nframes) {
+        const size_t absolute_frame = start_frame + first_frame;
+
+        if (reading_mode == read_mode::fast) {
+            return cd_rom.read_frames_c2(frames_to_msf_location(absolute_frame), nframes, read_batch_buffer.data(),
+                                         read_batch_c2.data());
+        }
+
+        // the frame before the batch, as read earlier, shows where the batch has to line up
+        const bool has_anchor = absolute_frame > buffer->get_first_frame()
+                                && buffer->read_frame(absolute_frame - 1, anchor_samples);
+        const auto result = secure_reader.read(absolute_frame, nframes, read_batch_buffer.data(),
+                                               buffer->get_first_frame(), buffer->get_end_frame(),
+                                               has_anchor ? reinterpret_cast<const u_int8_t *>(anchor_samples.data()) : nullptr,
+                                               read_batch_c2.data());
+        if (!result) {
+            return std::unexpected(result.error());
+        }
+        if (metrics != nullptr) {
+            metrics->secure_rereads.fetch_add(result->rereads, std::memory_order_relaxed);
+            metrics->unverified_frames.fetch_add(result->unverified_frames, std::memory_order_relaxed);
+            if (result->jitter_corrected) {
+                metrics->jitter_corrections.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        return {};
+    }
+
+    std::expected<size_t, int> CdPlayerTrack::read_batch(const size_t first_frame, const size_t end_frame) {
+        std::lock_guard lg(this->read_mutex);
+        AUDIPI_TRACE_NAMED_SPAN(span, "CdPlayerTrack::read_batch");
+
+        const subchannel_mode polling = subchannel_polling;
+        const size_t max_frames = polling == subchannel_mode::per_frame ? 1 : READ_BATCH_FRAMES;
+
+        size_t nframes = 0;
+        while (nframes < max_frames && first_frame + nframes < end_frame
+               && !buffer->has_frame(start_frame + first_frame + nframes)) {
+            ++nframes;
+        }
+
+        if (nframes == 0) {
+            return 0;
+        }
+
+        // frames stored on disk by an earlier play are served from there, without waking the drive up
+        if (persistent_cache) {
+            size_t nstored = 0;
+            while (nstored < nframes) {
+                const u_int8_t *raw_data = persistent_cache->get_frame(start_frame + first_frame + nstored);
+                if (raw_data == nullptr) {
                     break;
                 }
+                buffer->add_frame(start_frame + first_frame + nstored, raw_data);
+                ++nstored;
+            }
+            if (nstored > 0) {
+                AUDIPI_TRACE_SPAN_ARG(span, "persistent_frames", nstored);
+                return nstored;
+            }
+        }
+
+        AUDIPI_TRACE_SPAN_ARG(span, "frames", nframes);
+        const auto read_start = std::chrono::steady_clock::now();
+        const auto result = this->read_from_drive(first_frame, nframes);
+        if (metrics != nullptr) {
+            metrics->read_latency_us.observe(static_cast<u_int64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - read_start)
+                .count()));
+        }
+        if (!result) {
+            return std::unexpected(result.error());
+        }
+        if (metrics != nullptr) {
+            metrics->frames_read.fetch_add(nframes, std::memory_order_relaxed);
+        }
+
+        // frames the drive could not correct are not cached: they are read again when playback needs them
+        const auto c2_frame = [this](const size_t i) { return read_batch_c2.data() + i * CD_C2_BYTES; };
+        for (size_t i = 0; i < nframes; ++i) {
+            if (std::any_of(c2_frame(i), c2_frame(i) + CD_C2_BYTES, [](const u_int8_t bits) { return bits != 0; })) {
+                nframes = i;
+                break;
+            }
+        }
+        if (nframes == 0) {
+            damaged_frame = first_frame;
+            std::memcpy(damaged_samples.data(), read_batch_buffer.data(), CD_FRAMESIZE_RAW);
+            std::memcpy(damaged_c2.data(), c2_frame(0), CD_C2_BYTES);
+            if (metrics != nullptr) {
+                metrics->c2_damaged_reads.fetch_add(1, std::memory_order_relaxed);
+            }
+            return std::unexpected(EIO);
+        }
+
+        for (size_t i = 0; i < nframes; ++i) {
+            buffer->add_frame(start_frame + first_frame + i, read_batch_buffer.data() + i * CD_FRAMESIZE_RAW);
+        }
+        if (polling != subchannel_mode::none) {
+            // the position is informational, a failed poll must not fail the audio that was read
+            if (auto subchannel = cd_rom.read_subchannel()) {
+                std::lock_guard subchannel_lg(this->subchannel_mutex);
+                last_subchannel = subchannel.value();
+            } else {
+                AUDIPI_TRACE_INSTANT("CdPlayerTrack::subchannel_error", "error", subchannel.error());
             }
+        }
 
-            samples_to_fetch -= SAMPLES_IN_FRAME;
-            location = location + SAMPLES_IN_FRAME;
+        if (persistent_cache) {
+            persistent_cache->store_frames(start_frame + first_frame, nframes, read_batch_buffer.data());
         }
+
+        return nframes;
+    }
+
+    void CdPlayerTrack::set_subchannel_mode(const subchannel_mode mode) {
+        this->subchannel_polling = mode;
+    }
+
+    void CdPlayerTrack::set_read_mode(const read_mode mode) {
+        this->reading_mode = mode;
+    }
+
+    void CdPlayerTrack::set_metrics(PlayerMetrics *metrics) {
+        this->metrics = metrics;
+    }
+
+    std::optional<subchannel_position> CdPlayerTrack::get_last_subchannel() const {
+        std::lock_guard lg(this->subchannel_mutex);
+
+        return this->last_subchannel;
+    }
+
+    bool CdPlayerTrack::is_read_complete() const {
+        return next_queued_frame >= msf_location_to_frames(track.duration);
+    }
+
+    bool CdPlayerTrack::is_finished() const {
+        return current_frame >= msf_location_to_frames(track.duration);
     }
 } // namespace audipi
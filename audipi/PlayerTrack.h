@@ -1,33 +1,249 @@
 #ifndef PLAYERTRACK_H
 #define PLAYERTRACK_H
+#include <atomic>
+#include <chrono>
 #include <expected>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
 #include <vector>
 
 #include "CdRom.h"
+#include "PersistentCache.h"
+#include "PlayerMetrics.h"
 #include "SampleBuffer.h"
+#include "SecureReader.h"
+#include "SpeedGovernor.h"
+#include "SpscQueue.h"
 #include "structs.h"
 
 namespace audipi {
-    class CdPlayerTrack {
+    // how much of the start of a track to keep ready, so that skipping to it starts right away
+    constexpr size_t NEIGHBOUR_PREFETCH_FRAMES = 5 * 75;
+
+    struct queued_frame {
+        size_t frame; // relative to the start of the track
+        std::array<sample_data, SAMPLES_IN_FRAME> samples;
+    };
+
+    /**
+    * @brief A playable source of 44.1 kHz stereo samples, such as a track on a CD or in a disc image.
+    */
+    class PlayerTrack {
+    public:
+        virtual ~PlayerTrack() = default;
+
+        /**
+        * @brief Rewinds the track to its start. Must not be called while the read-ahead thread is working on it.
+        */
+        virtual void reset() = 0;
+
+        /**
+        * @brief Moves the play cursor to location (clamped to the end of the track) and gets playback data ready there,
+        * reading synchronously if needed. Must not be called while the read-ahead thread is working on it.
+        */
+        [[nodiscard]] virtual std::expected<void, int> seek(const msfs_location &location) = 0;
+
+        [[nodiscard]] virtual std::string get_track_name() const = 0; // todo add tags (artist, album...)
+
+        /**
+        * @brief Returns samples from the play cursor on, in place: nothing is copied or allocated, the source is never
+        * read synchronously and no lock is taken. The span is empty if no data is ready yet, and stays valid until
+        * consume_samples().
+        */
+        [[nodiscard]] virtual std::expected<std::span<const sample_data>, int> peek_samples() = 0;
+
+        /**
+        * @brief Advances the play cursor past num_samples samples of the last peek_samples() span.
+        */
+        virtual void consume_samples(size_t num_samples) = 0;
+
+        /**
+        * @brief Does one step of background reading for the read-ahead thread, keeping data ready frames_ahead frames
+        * ahead of the play cursor. Returns false if there was nothing left to do.
+        */
+        [[nodiscard]] virtual std::expected<bool, int> read_ahead([[maybe_unused]] size_t frames_ahead) {
+            return false;
+        }
+
+        /**
+        * @brief Does one step of reading the first frames of the track ahead of time, without touching the play
+        * cursor, so that playback can start right away when the track is selected. Returns false if there was nothing
+        * left to do.
+        */
+        [[nodiscard]] virtual std::expected<bool, int> prefetch_start([[maybe_unused]] size_t frames) {
+            return false;
+        }
+
+        /**
+        * @brief True once read_ahead() has handed over everything up to the end of the track, so that the read-ahead
+        * thread can move on to the track played after it. Only meaningful on the read-ahead thread.
+        */
+        [[nodiscard]] virtual bool is_read_complete() const {
+            return true;
+        }
+
+        /**
+        * @brief Tells the track how many samples the audio device still holds: how long a read error may be retried
+        * before the listener would hear the gap.
+        */
+        virtual void set_output_buffered([[maybe_unused]] size_t samples) {
+        }
+
+        /**
+        * @brief How soon the read-ahead thread may call read_ahead() again after it failed, e.g. to retry a read while
+        * playback still has time. The thread never waits longer than its own error backoff.
+        */
+        [[nodiscard]] virtual std::chrono::microseconds get_retry_delay() const {
+            return std::chrono::microseconds::max();
+        }
+
+        [[nodiscard]] virtual bool is_finished() const = 0;
+
+        [[nodiscard]] virtual msfs_location get_current_location() const = 0;
+    };
+
+    class CdPlayerTrack final : public PlayerTrack {
         CdRom &cd_rom;
-        SampleBuffer buffer;
+        const std::shared_ptr<SampleBuffer> buffer; // shared by all the tracks of the disc
         const disk_toc_entry track;
+        const size_t start_frame; // absolute frame number of the start of the track, the key into buffer
+        // frames kept on disk across plays of the same disc, null if disabled
+        const std::shared_ptr<PersistentCache> persistent_cache;
         msfs_location current_location;
 
+        // frame under the play cursor, shared with the read-ahead thread
+        std::atomic<size_t> current_frame;
+
+        // decoded frames handed from the read-ahead thread (producer) to playback (consumer)
+        SpscQueue<queued_frame> queue;
+        // next frame to push into queue, owned by the read-ahead thread
+        size_t next_queued_frame;
+        // last error returned by the drive while reading ahead that cannot be concealed, 0 if none
+        std::atomic<int> read_error;
+
+        // samples the audio device holds, as last reported by the player
+        std::atomic<size_t> output_buffered{0};
+        // set once the player reports the output, i.e. while this track is the one playing, until reset()
+        std::atomic<bool> playing{false};
+        // frame the playback queue is waiting for that failed to read, and until when it is retried before it is
+        // concealed, both owned by the read-ahead thread
+        size_t retried_frame = static_cast<size_t>(-1);
+        std::chrono::steady_clock::time_point retry_deadline;
+        std::array<sample_data, SAMPLES_IN_FRAME> concealed_samples{};
+
+        // serializes drive reads between prefetch_samples() and the read-ahead thread
+        std::mutex read_mutex;
+        std::vector<u_int8_t> read_batch_buffer;
+        std::vector<u_int8_t> read_batch_c2; // C2 pointers of read_batch_buffer
+        // last read of a frame the drive flagged with C2 errors, kept so that concealing it only has to make up the
+        // samples it flagged, under read_mutex
+        size_t damaged_frame = static_cast<size_t>(-1);
+        std::array<sample_data, SAMPLES_IN_FRAME> damaged_samples{};
+        std::array<u_int8_t, CD_C2_BYTES> damaged_c2{};
+
+        PlayerMetrics *metrics = nullptr;
+        SpeedGovernor *speed_governor = nullptr; // shared by the tracks of the disc, null if disabled
+        size_t missed_frame = static_cast<size_t>(-1); // last frame the playback queue missed, so that it is not also counted as a hit
+
+        std::atomic<read_mode> reading_mode{read_mode::fast};
+        SecureReader secure_reader; // used under read_mutex
+        std::array<sample_data, SAMPLES_IN_FRAME> anchor_samples{};
+
+        std::atomic<subchannel_mode> subchannel_polling{subchannel_mode::none};
+        mutable std::mutex subchannel_mutex;
+        std::optional<subchannel_position> last_subchannel;
+
+        std::expected<size_t, int> read_batch(size_t first_frame, size_t end_frame);
+
+        // reads frames [first_frame, first_frame + nframes) of the track into read_batch_buffer, in reading_mode
+        std::expected<void, int> read_from_drive(size_t first_frame, size_t nframes);
+
+        std::expected<bool, int> read_missing(size_t first_frame, size_t end_frame);
+
+        // moves frame next_queued_frame from the cache into the playback queue, false if it is full or on a miss
+        bool queue_cached_frame();
+
+        // time left until playback runs out of what is already queued
+        [[nodiscard]] std::chrono::microseconds playout_budget() const;
+
+        // makes up frame from its neighbours, bridging them if the one after it is known and repeating the one before
+        // it otherwise; of a frame that was read with C2 errors, only the samples the drive flagged
+        void conceal_frame(size_t frame);
+
+        // tells the speed governor how far ahead of playback the read-ahead is
+        void report_fill(size_t ready_end_frame, size_t frames_ahead) const;
+
     public:
-        CdPlayerTrack(CdRom &cd_rom, const disk_toc_entry &track);
+        CdPlayerTrack(CdRom &cd_rom, const disk_toc_entry &track, std::shared_ptr<SampleBuffer> buffer,
+                      std::shared_ptr<PersistentCache> persistent_cache = nullptr);
 
-        CdPlayerTrack(const CdPlayerTrack &other);
+        void reset() override;
 
-        void reset();
+        /**
+        * @brief Serves cached frames from location right away; on a miss, reads one batch at location first and
+        * leaves the rest to the read-ahead thread.
+        */
+        [[nodiscard]] std::expected<void, int> seek(const msfs_location &location) override;
 
-        [[nodiscard]] std::string get_track_name() const; // todo add tags (artist, album...)
+        [[nodiscard]] std::string get_track_name() const override;
 
-        [[nodiscard]] std::expected<std::vector<sample_data>, int> pop_samples(size_t num_samples);
+        /**
+        * @brief Returns the samples handed over by the read-ahead thread from the play cursor to the end of its frame.
+        */
+        [[nodiscard]] std::expected<std::span<const sample_data>, int> peek_samples() override;
+
+        void consume_samples(size_t num_samples) override;
 
         void prefetch_samples(size_t num_samples);
 
-        [[nodiscard]] msfs_location get_current_location() const {
+        /**
+        * @brief Sets whether drive reads also poll the Q subchannel. Off by default: the audio path does not need it,
+        * and every poll is one more command interrupting the drive mid-stream.
+        */
+        void set_subchannel_mode(subchannel_mode mode);
+
+        /**
+        * @brief Sets whether drive reads are verified and realigned (read_mode::secure), at the cost of reading
+        * everything at least twice. Fast by default.
+        */
+        void set_read_mode(read_mode mode);
+
+        /**
+        * @brief Starts counting reads and cache hits into metrics. Must be called before the track is read from.
+        */
+        void set_metrics(PlayerMetrics *metrics);
+
+        /**
+        * @brief Lets governor adapt the drive speed to how this track's read-ahead keeps up. Must be called before the
+        * track is read from.
+        */
+        void set_speed_governor(SpeedGovernor *governor);
+
+        /**
+        * @brief Subchannel data from the last poll, if any.
+        */
+        [[nodiscard]] std::optional<subchannel_position> get_last_subchannel() const;
+
+        /**
+        * @brief Moves the next cached frame into the playback queue, or reads the first frame missing from the cache
+        * within frames_ahead frames of the play cursor.
+        */
+        [[nodiscard]] std::expected<bool, int> read_ahead(size_t frames_ahead) override;
+
+        [[nodiscard]] std::expected<bool, int> prefetch_start(size_t frames) override;
+
+        [[nodiscard]] bool is_read_complete() const override;
+
+        void set_output_buffered(size_t samples) override;
+
+        [[nodiscard]] std::chrono::microseconds get_retry_delay() const override;
+
+        [[nodiscard]] bool is_finished() const override;
+
+        [[nodiscard]] msfs_location get_current_location() const override {
             return current_location;
         }
     };
@@ -1,53 +1,179 @@
 #include "SampleBuffer.h"
 
+#include <algorithm>
+#include <cstring>
+#include <linux/cdrom.h>
+
+#include "Trace.h"
 #include "structs.h"
 
+static_assert(sizeof(std::array<audipi::sample_data, SAMPLES_IN_FRAME>) == CD_FRAMESIZE_RAW,
+              "a frame of samples must have the layout of a raw CD frame");
+
 namespace audipi {
-    SampleBuffer::SampleBuffer(const size_t max_frames) {
-        this->max_frames = max_frames;
+    SampleBuffer::SampleBuffer(const size_t max_bytes, const size_t first_frame, const size_t total_frames,
+                               std::vector<size_t> track_starts)
+        : slot_samples(new frame_samples[std::max<size_t>(max_bytes / CD_FRAMESIZE_RAW, 1)]),
+          slot_frames(std::max<size_t>(max_bytes / CD_FRAMESIZE_RAW, 1), NO_FRAME),
+          slot_referenced(slot_frames.size(), false), first_frame(first_frame), index(total_frames, NO_SLOT),
+          track_starts(std::move(track_starts)) {
+        std::ranges::sort(this->track_starts);
+    }
+
+    std::shared_ptr<SampleBuffer> SampleBuffer::for_disc(const disk_toc &toc, const size_t max_bytes) {
+        if (toc.entries.empty()) {
+            return std::make_shared<SampleBuffer>(max_bytes, 0, 0);
+        }
+
+        std::vector<size_t> track_starts;
+        for (const auto &entry: toc.entries) {
+            track_starts.push_back(msf_location_to_frames(entry.address));
+        }
+
+        const auto &last = toc.entries.back();
+        const size_t end_frame = msf_location_to_frames(last.address) + msf_location_to_frames(last.duration);
+
+        return std::make_shared<SampleBuffer>(max_bytes, track_starts.front(), end_frame - track_starts.front(),
+                                              std::move(track_starts));
     }
 
-    SampleBuffer::SampleBuffer(const SampleBuffer &other): cache(other.cache), expired(other.expired), max_frames(other.max_frames) {
+    bool SampleBuffer::is_protected(const size_t frame) const {
+        const auto contains = [frame](const frame_range &range) {
+            return frame >= range.first && frame < range.end;
+        };
+        return std::ranges::any_of(this->windows, [&](const protected_window &window) {
+            return contains(window.frames);
+        }) || std::ranges::any_of(this->neighbour_starts, contains);
     }
 
-    void SampleBuffer::add_frame(const msf_location location, const std::array<sample_data, SAMPLES_IN_FRAME> &samples) {
-        std::lock_guard lg(this->mutex);
+    SampleBuffer::frame_samples &SampleBuffer::slot_for(const size_t frame) {
+        auto &frame_slot = this->index[frame - this->first_frame];
+        if (frame_slot != NO_SLOT) {
+            return this->slot_samples[frame_slot];
+        }
+
+        size_t slot;
+        if (this->used_slots < this->slot_frames.size()) {
+            slot = this->used_slots++;
+        } else {
+            // second chance clock, skipping protected frames for up to two sweeps
+            size_t steps = 0;
+            while (steps < 2 * this->slot_frames.size()) {
+                const size_t candidate = this->clock_hand;
+                this->clock_hand = (this->clock_hand + 1) % this->slot_frames.size();
+                ++steps;
 
-        if (this->cache.size() == max_frames) {
-            for (auto expired_i : this->expired) {
-                this->cache.erase(expired_i);
+                if (this->is_protected(this->slot_frames[candidate])) {
+                    continue;
+                }
+                if (this->slot_referenced[candidate]) {
+                    this->slot_referenced[candidate] = false;
+                    continue;
+                }
+                break;
+            }
+            // everything is protected: the budget is smaller than the protected ranges, evict in order
+            slot = (this->clock_hand + this->slot_frames.size() - 1) % this->slot_frames.size();
+
+            if (const size_t evicted = this->slot_frames[slot]; evicted != NO_FRAME) {
+                this->index[evicted - this->first_frame] = NO_SLOT;
             }
-            this->expired.clear();
         }
 
-        this->cache[location] = samples;
+        this->slot_frames[slot] = frame;
+        this->slot_referenced[slot] = false;
+        frame_slot = static_cast<u_int32_t>(slot);
+        return this->slot_samples[slot];
+    }
+
+    void SampleBuffer::add_frame(const size_t frame, const std::array<sample_data, SAMPLES_IN_FRAME> &samples) {
+        AUDIPI_TRACE_SPAN("SampleBuffer::add_frame");
+        std::lock_guard lg(this->mutex);
 
-        if (const auto found = std::ranges::find(this->expired, location); found != this->expired.end()) {
-            this->expired.erase(found);
+        if (frame - this->first_frame >= this->index.size()) {
+            return;
         }
+        this->slot_for(frame) = samples;
     }
 
-    bool SampleBuffer::has_frame(const msf_location &location) const {
-        return this->cache.contains(location);
+    void SampleBuffer::add_frame(const size_t frame, const u_int8_t *raw_data) {
+        AUDIPI_TRACE_SPAN("SampleBuffer::add_frame");
+        std::lock_guard lg(this->mutex);
+
+        if (frame - this->first_frame >= this->index.size()) {
+            return;
+        }
+        std::memcpy(this->slot_for(frame).data(), raw_data, CD_FRAMESIZE_RAW);
     }
 
-    std::array<sample_data, SAMPLES_IN_FRAME> SampleBuffer::read_frame(const msf_location &location) {
+    bool SampleBuffer::has_frame(const size_t frame) const {
         std::lock_guard lg(this->mutex);
 
-        this->expired.insert(location);
-        return this->cache[location];
+        return frame - this->first_frame < this->index.size() && this->index[frame - this->first_frame] != NO_SLOT;
     }
 
-    void SampleBuffer::discard_frame(const msf_location &location) {
+    bool SampleBuffer::read_frame(const size_t frame, std::array<sample_data, SAMPLES_IN_FRAME> &samples) {
+        AUDIPI_TRACE_SPAN("SampleBuffer::read_frame");
         std::lock_guard lg(this->mutex);
 
-        this->expired.insert(location);
+        if (frame - this->first_frame >= this->index.size()) {
+            return false;
+        }
+        const u_int32_t slot = this->index[frame - this->first_frame];
+        if (slot == NO_SLOT) {
+            return false;
+        }
+        this->slot_referenced[slot] = true;
+        samples = this->slot_samples[slot];
+        return true;
+    }
+
+    void SampleBuffer::protect(const window_role role, const void *owner, const size_t first_frame,
+                               const size_t end_frame, const size_t track_start_frames) {
+        std::lock_guard lg(this->mutex);
+
+        // a pre-rolled track that starts playing moves its window from following to current
+        this->release_locked(owner);
+        this->windows[static_cast<size_t>(role)] = {owner, {first_frame, end_frame}};
+        if (role != window_role::current) {
+            return;
+        }
+
+        // track holding first_frame, i.e. the last one starting at or before it
+        this->neighbour_starts = {};
+        const auto next = std::ranges::upper_bound(this->track_starts, first_frame);
+        if (next != this->track_starts.end()) {
+            this->neighbour_starts[0] = {*next, *next + track_start_frames};
+        }
+        if (next - this->track_starts.begin() >= 2) {
+            const size_t prev_start = *(next - 2);
+            this->neighbour_starts[1] = {prev_start, prev_start + track_start_frames};
+        }
+    }
+
+    void SampleBuffer::release(const void *owner) {
+        std::lock_guard lg(this->mutex);
+
+        this->release_locked(owner);
+    }
+
+    void SampleBuffer::release_locked(const void *owner) {
+        for (auto &window: this->windows) {
+            if (window.owner == owner) {
+                window = {};
+            }
+        }
+        if (this->windows[static_cast<size_t>(window_role::current)].owner == nullptr) {
+            this->neighbour_starts = {};
+        }
     }
 
     void SampleBuffer::discard() {
         std::lock_guard lg(this->mutex);
 
-        cache.clear();
-        expired.clear();
+        std::ranges::fill(this->slot_frames, NO_FRAME);
+        std::ranges::fill(this->index, NO_SLOT);
+        this->used_slots = 0;
+        this->clock_hand = 0;
     }
 }
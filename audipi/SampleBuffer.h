@@ -1,48 +1,124 @@
 #ifndef SAMPLEBUFFER_H
 #define SAMPLEBUFFER_H
+#include <array>
+#include <memory>
 #include <mutex>
-#include <map>
-#include <set>
+#include <vector>
 
 #include "structs.h"
 
-template<> struct std::less<audipi::msf_location>
-{
-    bool operator() (const audipi::msf_location& lhs, const audipi::msf_location& rhs) const {
-        if (lhs.minute == rhs.minute) {
-            if (lhs.second == rhs.second) {
-                return lhs.frame < rhs.frame;
-            }
-            return lhs.second < rhs.second;
-        }
-        return lhs.minute < rhs.minute;
-    }
-};
-
 namespace audipi {
+    /**
+    * @brief Whose play window SampleBuffer::protect() keeps: the track playing, or the one pre-rolled to follow it.
+    */
+    enum class window_role { current, following };
+
+    /**
+    * @brief Cache of decoded frames shared by all the tracks of a disc, keyed by absolute frame number.
+    * Frames live in a fixed number of slots sized from a byte budget, found through an index spanning the whole disc,
+    * so lookup and insertion are O(1) and nothing is allocated after construction.
+    * When full, the least recently used frame (approximated with a clock) is evicted, except for the protected
+    * frames: the play window of the current track, the start of the tracks around it, and the pre-roll window of the
+    * track following it.
+    */
     class SampleBuffer {
-        std::map<msf_location, std::array<sample_data, SAMPLES_IN_FRAME>> cache;
+        static constexpr size_t NO_FRAME = static_cast<size_t>(-1);
+        static constexpr u_int32_t NO_SLOT = static_cast<u_int32_t>(-1);
+
+        struct frame_range {
+            size_t first = 0;
+            size_t end = 0;
+        };
+
+        struct protected_window {
+            const void *owner = nullptr;
+            frame_range frames;
+        };
 
-        std::set<msf_location> expired;
+        using frame_samples = std::array<sample_data, SAMPLES_IN_FRAME>;
 
-        size_t max_frames;
+        // left uninitialized, so that the budget only turns into memory as frames are added
+        std::unique_ptr<frame_samples[]> slot_samples;
+        std::vector<size_t> slot_frames;
+        std::vector<bool> slot_referenced;
+        size_t used_slots = 0;
+        size_t clock_hand = 0;
+
+        const size_t first_frame;
+        std::vector<u_int32_t> index; // frame - first_frame -> slot
+
+        std::vector<size_t> track_starts; // absolute, sorted
+        std::array<protected_window, 2> windows{}; // indexed by window_role
+        std::array<frame_range, 2> neighbour_starts{}; // of the tracks around the current window
 
         mutable std::mutex mutex;
 
+        [[nodiscard]] bool is_protected(size_t frame) const;
+
+        // with the lock held
+        void release_locked(const void *owner);
+
+        frame_samples &slot_for(size_t frame);
+
     public:
-        explicit SampleBuffer(size_t max_frames);
+        /**
+        * @brief Cache for frames [first_frame, first_frame + total_frames), holding at most max_bytes of samples.
+        * track_starts lists the absolute first frame of each track, to protect the start of the neighbouring tracks.
+        */
+        SampleBuffer(size_t max_bytes, size_t first_frame, size_t total_frames, std::vector<size_t> track_starts = {});
 
-        SampleBuffer(const SampleBuffer& other);
+        SampleBuffer(const SampleBuffer &) = delete;
+        SampleBuffer &operator=(const SampleBuffer &) = delete;
 
-        void add_frame(msf_location location, const std::array<sample_data, SAMPLES_IN_FRAME> &samples);
+        [[nodiscard]] size_t get_first_frame() const {
+            return first_frame;
+        }
+
+        [[nodiscard]] size_t get_end_frame() const {
+            return first_frame + index.size();
+        }
+
+        /**
+        * @brief Cache spanning the whole disc, for all of its tracks to share.
+        */
+        [[nodiscard]] static std::shared_ptr<SampleBuffer> for_disc(const disk_toc &toc, size_t max_bytes);
+
+        /**
+        * @brief Stores a frame, evicting the least recently used unprotected frame if the cache is full.
+        */
+        void add_frame(size_t frame, const std::array<sample_data, SAMPLES_IN_FRAME> &samples);
 
-        bool has_frame(const msf_location &location) const;
+        /**
+        * @brief Stores a frame straight from the drive's raw little-endian data (CD_FRAMESIZE_RAW bytes).
+        */
+        void add_frame(size_t frame, const u_int8_t *raw_data);
 
-        std::array<sample_data, SAMPLES_IN_FRAME> read_frame(const msf_location &location);
+        [[nodiscard]] bool has_frame(size_t frame) const;
 
-        void discard_frame(const msf_location &location);
+        /**
+        * @brief Copies a cached frame into samples, returns false (leaving samples untouched) on a miss.
+        */
+        [[nodiscard]] bool read_frame(size_t frame, std::array<sample_data, SAMPLES_IN_FRAME> &samples);
+
+        /**
+        * @brief Keeps frames [first_frame, end_frame) from being evicted as the window of role, until owner or
+        * another track protects a window for that role, or owner releases it. owner gives up any window it held for
+        * the other role. The current window also protects the first track_start_frames frames of the tracks before
+        * and after the one holding first_frame.
+        */
+        void protect(window_role role, const void *owner, size_t first_frame, size_t end_frame,
+                     size_t track_start_frames);
+
+        /**
+        * @brief Lets the frames of whatever window owner protected be evicted again.
+        */
+        void release(const void *owner);
 
         void discard();
+
+        [[nodiscard]] size_t capacity() const {
+            return slot_frames.size();
+        }
     };
 }
 
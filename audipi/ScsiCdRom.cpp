@@ -0,0 +1,194 @@
+#include "ScsiCdRom.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "Trace.h"
+
+constexpr u_int8_t READ_CD = 0xBE;
+constexpr u_int8_t READ_CD_SECTOR_TYPE_CDDA = 0x04;
+constexpr u_int8_t READ_CD_USER_DATA = 0x10;
+constexpr u_int8_t READ_CD_C2_ERROR_POINTERS = 0x02;
+constexpr u_int8_t READ_CD_SUBCHANNEL_Q = 0x02;
+
+constexpr u_int8_t SENSE_NOT_READY = 0x02;
+constexpr u_int8_t SENSE_ILLEGAL_REQUEST = 0x05;
+constexpr u_int8_t ASC_INVALID_FIELD_IN_CDB = 0x24;
+constexpr u_int8_t ASC_MEDIUM_NOT_PRESENT = 0x3A;
+
+// Q subchannel mode 1, the one carrying the position
+constexpr u_int8_t Q_ADR_POSITION = 0x01;
+
+namespace {
+    u_int8_t from_bcd(const u_int8_t value) {
+        return static_cast<u_int8_t>((value >> 4) * 10 + (value & 0x0F));
+    }
+
+    int sense_to_errno(const audipi::scsi_result &result) {
+        if (result.sense_key == SENSE_ILLEGAL_REQUEST) {
+            // a field the drive does not implement, as opposed to a bad request such as an LBA out of range
+            return result.asc == ASC_INVALID_FIELD_IN_CDB ? EOPNOTSUPP : EINVAL;
+        }
+        if (result.sense_key == SENSE_NOT_READY) {
+            return result.asc == ASC_MEDIUM_NOT_PRESENT ? ENOMEDIUM : EBUSY;
+        }
+        return EIO;
+    }
+
+    std::optional<audipi::subchannel_position> parse_q(const u_int8_t *q) {
+        if ((q[0] & 0x0F) != Q_ADR_POSITION) {
+            return std::nullopt;
+        }
+        return audipi::subchannel_position{
+            from_bcd(q[1]),
+            from_bcd(q[2]),
+            {from_bcd(q[7]), from_bcd(q[8]), from_bcd(q[9])},
+            {from_bcd(q[3]), from_bcd(q[4]), from_bcd(q[5])}
+        };
+    }
+}
+
+namespace audipi {
+    ScsiCdRom::ScsiCdRom(const std::string &fd_path, const std::chrono::milliseconds timeout)
+        : CdRom(fd_path), transport(std::make_unique<SgIoTransport>(get_fd())), timeout(timeout) {
+    }
+
+    ScsiCdRom::ScsiCdRom(std::unique_ptr<ScsiTransport> transport, const std::chrono::milliseconds timeout)
+        : transport(std::move(transport)), timeout(timeout) {
+    }
+
+    std::expected<void, int> ScsiCdRom::read_cd_command(const size_t lba, const size_t nframes,
+                                                        const bool with_c2) const {
+        const size_t frame_bytes = CD_FRAMESIZE_RAW + (with_c2 ? CD_C2_BYTES : 0) + CD_Q_BYTES;
+        this->transfer_buffer.resize(nframes * frame_bytes);
+
+        scsi_command command{
+            .cdb = {
+                READ_CD, READ_CD_SECTOR_TYPE_CDDA,
+                static_cast<u_int8_t>(lba >> 24), static_cast<u_int8_t>(lba >> 16),
+                static_cast<u_int8_t>(lba >> 8), static_cast<u_int8_t>(lba),
+                static_cast<u_int8_t>(nframes >> 16), static_cast<u_int8_t>(nframes >> 8),
+                static_cast<u_int8_t>(nframes),
+                static_cast<u_int8_t>(READ_CD_USER_DATA | (with_c2 ? READ_CD_C2_ERROR_POINTERS : 0)),
+                READ_CD_SUBCHANNEL_Q, 0
+            },
+            .cdb_length = 12,
+            .data_in = this->transfer_buffer.data(),
+            .data_in_length = this->transfer_buffer.size(),
+            .timeout = this->timeout
+        };
+
+        const auto result = this->transport->execute(command);
+        if (!result) {
+            return std::unexpected(result.error());
+        }
+        if (result->status != SCSI_STATUS_GOOD) {
+            return std::unexpected(sense_to_errno(result.value()));
+        }
+        if (result->residual != 0) {
+            return std::unexpected(EIO);
+        }
+        return {};
+    }
+
+    std::expected<size_t, int> ScsiCdRom::read_cd(const msf_location &location, const size_t nframes,
+                                                  u_int8_t *audio, u_int8_t *c2_pointers,
+                                                  subchannel_position *subchannel) const {
+        AUDIPI_TRACE_NAMED_SPAN(span, "ScsiCdRom::read_cd");
+        AUDIPI_TRACE_SPAN_ARG(span, "frames", nframes);
+
+        const size_t first_frame = msf_location_to_frames(location);
+        if (nframes == 0 || first_frame < CD_MSF_OFFSET) {
+            return std::unexpected(EINVAL);
+        }
+
+        size_t c2_frames = 0;
+        std::optional<subchannel_position> last_read_position;
+
+        std::lock_guard lg(this->transfer_mutex);
+        for (size_t done = 0; done < nframes; done += MAX_READ_CD_FRAMES) {
+            const size_t count = std::min(MAX_READ_CD_FRAMES, nframes - done);
+            const size_t lba = first_frame - CD_MSF_OFFSET + done;
+
+            bool with_c2 = this->c2 != c2_support::unsupported;
+            auto result = this->read_cd_command(lba, count, with_c2);
+            if (!result && result.error() == EOPNOTSUPP && this->c2 == c2_support::unknown) {
+                // not every drive reports C2 errors, the audio is still worth having without them; once a read with
+                // them went through, any error is the read's own
+                this->c2 = c2_support::unsupported;
+                with_c2 = false;
+                result = this->read_cd_command(lba, count, with_c2);
+            }
+            if (!result) {
+                return std::unexpected(result.error());
+            }
+            if (with_c2) {
+                this->c2 = c2_support::supported;
+            }
+
+            const size_t frame_bytes = CD_FRAMESIZE_RAW + (with_c2 ? CD_C2_BYTES : 0) + CD_Q_BYTES;
+            for (size_t i = 0; i < count; ++i) {
+                const size_t frame = done + i;
+                const u_int8_t *data = this->transfer_buffer.data() + i * frame_bytes;
+
+                std::memcpy(audio + frame * CD_FRAMESIZE_RAW, data, CD_FRAMESIZE_RAW);
+
+                if (with_c2) {
+                    const u_int8_t *c2 = data + CD_FRAMESIZE_RAW;
+                    if (std::any_of(c2, c2 + CD_C2_BYTES, [](const u_int8_t bits) { return bits != 0; })) {
+                        ++c2_frames;
+                    }
+                    if (c2_pointers != nullptr) {
+                        std::memcpy(c2_pointers + frame * CD_C2_BYTES, c2, CD_C2_BYTES);
+                    }
+                } else if (c2_pointers != nullptr) {
+                    std::memset(c2_pointers + frame * CD_C2_BYTES, 0, CD_C2_BYTES);
+                }
+
+                const auto position = parse_q(data + frame_bytes - CD_Q_BYTES);
+                if (position) {
+                    last_read_position = position;
+                }
+                if (subchannel != nullptr) {
+                    subchannel[frame] = position.value_or(subchannel_position{});
+                }
+            }
+        }
+
+        if (last_read_position) {
+            std::lock_guard subchannel_lg(this->subchannel_mutex);
+            this->last_position = last_read_position;
+        }
+        return c2_frames;
+    }
+
+    std::expected<subchannel_position, int> ScsiCdRom::read_subchannel() const {
+        {
+            std::lock_guard lg(this->subchannel_mutex);
+            if (this->last_position) {
+                return this->last_position.value();
+            }
+        }
+        if (this->get_fd() < 0) {
+            return std::unexpected(ENODATA);
+        }
+        return CdRom::read_subchannel();
+    }
+
+    std::expected<void, int> ScsiCdRom::read_frames(const msf_location &location, const size_t nframes,
+                                                    u_int8_t *buffer) const {
+        if (const auto result = this->read_cd(location, nframes, buffer); !result) {
+            return std::unexpected(result.error());
+        }
+        return {};
+    }
+
+    std::expected<void, int> ScsiCdRom::read_frames_c2(const msf_location &location, const size_t nframes,
+                                                       u_int8_t *buffer, u_int8_t *c2_pointers) const {
+        if (const auto result = this->read_cd(location, nframes, buffer, c2_pointers); !result) {
+            return std::unexpected(result.error());
+        }
+        return {};
+    }
+}
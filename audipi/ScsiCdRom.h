@@ -0,0 +1,76 @@
+#ifndef SCSICDROM_H
+#define SCSICDROM_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "CdRom.h"
+#include "ScsiTransport.h"
+
+namespace audipi {
+    // formatted Q subchannel of a frame
+    constexpr size_t CD_Q_BYTES = 16;
+    // frames per READ CD, keeping transfers under 72 KiB, which any host adapter takes in one go
+    constexpr size_t MAX_READ_CD_FRAMES = 27;
+    constexpr auto DEFAULT_READ_CD_TIMEOUT = std::chrono::milliseconds(3000);
+
+    /**
+    * @brief Drive read with MMC READ CD (0xBE) commands instead of the legacy CDROMREADAUDIO ioctl: each command
+    * returns the audio of a batch of frames together with their C2 error pointers and Q subchannel, and is aborted
+    * if the drive does not answer within a timeout. Everything else (TOC, tray, status) still goes through CdRom.
+    */
+    class ScsiCdRom final : public CdRom {
+        std::unique_ptr<ScsiTransport> transport;
+        const std::chrono::milliseconds timeout;
+
+        enum class c2_support { unknown, supported, unsupported };
+
+        // settled by the first READ CD asking for C2 errors: if the drive refuses the field, reads go on without them
+        mutable std::atomic<c2_support> c2{c2_support::unknown};
+
+        mutable std::mutex transfer_mutex;
+        mutable std::vector<u_int8_t> transfer_buffer;
+
+        mutable std::mutex subchannel_mutex;
+        mutable std::optional<subchannel_position> last_position;
+
+        std::expected<void, int> read_cd_command(size_t lba, size_t nframes, bool with_c2) const;
+
+    public:
+        explicit ScsiCdRom(const std::string &fd_path, std::chrono::milliseconds timeout = DEFAULT_READ_CD_TIMEOUT);
+
+        /**
+        * @brief Drive behind any transport, e.g. a fake one simulating a drive.
+        */
+        explicit ScsiCdRom(std::unique_ptr<ScsiTransport> transport,
+                           std::chrono::milliseconds timeout = DEFAULT_READ_CD_TIMEOUT);
+
+        /**
+        * @brief Reads nframes frames from location into audio with as few READ CD commands as possible. If
+        * c2_pointers is not null, it receives CD_C2_BYTES of error pointers per frame (all clear if the drive does not
+        * report them); if subchannel is not null, it receives the position of each frame, zeroed where the Q
+        * subchannel held no position. Returns the number of frames with C2 errors.
+        */
+        [[nodiscard]] std::expected<size_t, int> read_cd(const msf_location &location, size_t nframes, u_int8_t *audio,
+                                                         u_int8_t *c2_pointers = nullptr,
+                                                         subchannel_position *subchannel = nullptr) const;
+
+        /**
+        * @brief Position of the last frame read, from the subchannel data that came with it: no extra command is
+        * sent to the drive unless nothing was read yet.
+        */
+        [[nodiscard]] std::expected<subchannel_position, int> read_subchannel() const override;
+
+        [[nodiscard]] std::expected<void, int> read_frames(const msf_location &location, size_t nframes,
+                                                           u_int8_t *buffer) const override;
+
+        [[nodiscard]] std::expected<void, int> read_frames_c2(const msf_location &location, size_t nframes,
+                                                              u_int8_t *buffer, u_int8_t *c2_pointers) const override;
+    };
+}
+
+#endif //SCSICDROM_H
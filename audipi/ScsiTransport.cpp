@@ -0,0 +1,61 @@
+#include "ScsiTransport.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <sys/ioctl.h>
+#include <scsi/sg.h>
+
+#include "Trace.h"
+
+// host_status reported by the kernel when a command was aborted for taking longer than its timeout
+constexpr unsigned short SG_HOST_TIME_OUT = 0x03;
+// driver_status flag telling that the sense buffer was filled
+constexpr unsigned short SG_DRIVER_SENSE = 0x08;
+
+constexpr size_t SENSE_BUFFER_SIZE = 32;
+
+namespace audipi {
+    SgIoTransport::SgIoTransport(const int fd) : fd(fd) {
+    }
+
+    std::expected<scsi_result, int> SgIoTransport::execute(const scsi_command &command) {
+        AUDIPI_TRACE_NAMED_SPAN(span, "SgIoTransport::execute");
+        AUDIPI_TRACE_SPAN_ARG(span, "opcode", command.cdb[0]);
+
+        std::array<u_int8_t, 16> cdb = command.cdb;
+        std::array<u_int8_t, SENSE_BUFFER_SIZE> sense{};
+
+        sg_io_hdr_t header{};
+        header.interface_id = 'S';
+        header.dxfer_direction = command.data_in_length > 0 ? SG_DXFER_FROM_DEV : SG_DXFER_NONE;
+        header.cmd_len = command.cdb_length;
+        header.cmdp = cdb.data();
+        header.dxfer_len = static_cast<unsigned int>(command.data_in_length);
+        header.dxferp = command.data_in;
+        header.mx_sb_len = sense.size();
+        header.sbp = sense.data();
+        header.timeout = static_cast<unsigned int>(command.timeout.count());
+
+        if (ioctl(this->fd, SG_IO, &header) < 0) {
+            return std::unexpected(errno);
+        }
+        if (header.host_status == SG_HOST_TIME_OUT) {
+            return std::unexpected(ETIMEDOUT);
+        }
+        if (header.host_status != 0) {
+            return std::unexpected(EIO);
+        }
+
+        scsi_result result{header.status, 0, 0, 0, static_cast<size_t>(std::max(header.resid, 0))};
+        if ((header.driver_status & SG_DRIVER_SENSE) != 0 || header.status == SCSI_STATUS_CHECK_CONDITION) {
+            // fixed format sense data, the only one drives return to READ CD
+            if (header.sb_len_wr >= 14) {
+                result.status = SCSI_STATUS_CHECK_CONDITION;
+                result.sense_key = sense[2] & 0x0F;
+                result.asc = sense[12];
+                result.ascq = sense[13];
+            }
+        }
+        return result;
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef SCSITRANSPORT_H
+#define SCSITRANSPORT_H
+
+#include <array>
+#include <chrono>
+#include <expected>
+#include <sys/types.h>
+
+namespace audipi {
+    constexpr u_int8_t SCSI_STATUS_GOOD = 0x00;
+    constexpr u_int8_t SCSI_STATUS_CHECK_CONDITION = 0x02;
+
+    struct scsi_command {
+        std::array<u_int8_t, 16> cdb;
+        u_int8_t cdb_length;
+        u_int8_t *data_in; // filled by the device, may be null if data_in_length is 0
+        size_t data_in_length;
+        std::chrono::milliseconds timeout; // after which the command is aborted
+    };
+
+    struct scsi_result {
+        u_int8_t status; // SCSI status byte
+        u_int8_t sense_key; // only meaningful on SCSI_STATUS_CHECK_CONDITION
+        u_int8_t asc;
+        u_int8_t ascq;
+        size_t residual; // bytes of data_in that were not transferred
+    };
+
+    /**
+    * @brief Sends SCSI (MMC) commands to a drive. Implementations must allow commands from several threads at once.
+    */
+    class ScsiTransport {
+    public:
+        virtual ~ScsiTransport() = default;
+
+        /**
+        * @brief Runs command and returns the device's status. Fails only if the command could not be delivered or
+        * did not complete in time (ETIMEDOUT); device-reported errors come back as a status.
+        */
+        [[nodiscard]] virtual std::expected<scsi_result, int> execute(const scsi_command &command) = 0;
+    };
+
+    /**
+    * @brief Transport over the Linux SG_IO ioctl, on a device node opened elsewhere (e.g. /dev/sr0).
+    */
+    class SgIoTransport final : public ScsiTransport {
+        int fd;
+
+    public:
+        explicit SgIoTransport(int fd);
+
+        [[nodiscard]] std::expected<scsi_result, int> execute(const scsi_command &command) override;
+    };
+}
+
+#endif //SCSITRANSPORT_H
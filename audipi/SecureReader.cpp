@@ -0,0 +1,265 @@
+#include "SecureReader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "Trace.h"
+
+constexpr size_t SAMPLE_BYTES = sizeof(audipi::sample_data);
+
+namespace {
+    bool is_constant(const u_int8_t *samples, const size_t nsamples) {
+        for (size_t i = 1; i < nsamples; ++i) {
+            if (std::memcmp(samples, samples + i * SAMPLE_BYTES, SAMPLE_BYTES) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // index in haystack where needle starts, searched outwards from expected so that the smallest shift wins
+    std::optional<size_t> find_run(const u_int8_t *haystack, const size_t haystack_samples, const u_int8_t *needle,
+                                   const size_t expected) {
+        for (size_t distance = 0; distance <= audipi::MAX_JITTER_SAMPLES; ++distance) {
+            for (const long sign: {1L, -1L}) {
+                if (distance == 0 && sign < 0) {
+                    continue;
+                }
+                const long index = static_cast<long>(expected) + sign * static_cast<long>(distance);
+                if (index < 0 || static_cast<size_t>(index) + audipi::ALIGN_PROBE_SAMPLES > haystack_samples) {
+                    continue;
+                }
+                if (audipi::matching_samples(haystack + index * SAMPLE_BYTES, needle, audipi::ALIGN_PROBE_SAMPLES)
+                    == audipi::ALIGN_PROBE_SAMPLES) {
+                    return static_cast<size_t>(index);
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+    // whether C2 pointers flag any of nsamples samples from first_sample, which need not start a frame
+    bool is_damaged(const u_int8_t *c2_pointers, const size_t first_sample, const size_t nsamples) {
+        for (size_t sample = first_sample; sample < first_sample + nsamples; ++sample) {
+            if (audipi::is_sample_damaged(c2_pointers, sample)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // copies the C2 flags of nsamples samples from first_sample in from, to the samples from 0 in to
+    void copy_c2(const u_int8_t *from, const size_t first_sample, u_int8_t *to, const size_t nsamples) {
+        if (first_sample % 2 == 0) {
+            std::memcpy(to, from + first_sample / 2, nsamples / 2);
+            return;
+        }
+        std::memset(to, 0, nsamples / 2);
+        for (size_t sample = 0; sample < nsamples; ++sample) {
+            if (audipi::is_sample_damaged(from, first_sample + sample)) {
+                to[sample / 2] |= sample % 2 == 0 ? 0xF0 : 0x0F;
+            }
+        }
+    }
+}
+
+namespace audipi {
+    size_t matching_samples(const u_int8_t *a, const u_int8_t *b, const size_t nsamples) {
+        size_t i = 0;
+
+#if defined(__SSE2__)
+        const auto equal4 = [&](const size_t at) {
+            const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + at * SAMPLE_BYTES));
+            const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + at * SAMPLE_BYTES));
+            return _mm_cmpeq_epi32(va, vb);
+        };
+        // 16 samples per test while they match, the usual case
+        for (; i + 16 <= nsamples; i += 16) {
+            const __m128i equal = _mm_and_si128(_mm_and_si128(equal4(i), equal4(i + 4)),
+                                                _mm_and_si128(equal4(i + 8), equal4(i + 12)));
+            if (_mm_movemask_epi8(equal) != 0xFFFF) {
+                break;
+            }
+        }
+        for (; i + 4 <= nsamples; i += 4) {
+            if (_mm_movemask_epi8(equal4(i)) != 0xFFFF) {
+                break;
+            }
+        }
+#elif defined(__ARM_NEON)
+        const auto equal4 = [&](const size_t at) {
+            const uint32x4_t va = vreinterpretq_u32_u8(vld1q_u8(a + at * SAMPLE_BYTES));
+            const uint32x4_t vb = vreinterpretq_u32_u8(vld1q_u8(b + at * SAMPLE_BYTES));
+            return vceqq_u32(va, vb);
+        };
+        const auto all_set = [](const uint32x4_t equal) {
+            const uint64x2_t lanes = vreinterpretq_u64_u32(equal);
+            return (vgetq_lane_u64(lanes, 0) & vgetq_lane_u64(lanes, 1)) == ~0ULL;
+        };
+        // 16 samples per test while they match, the usual case
+        for (; i + 16 <= nsamples; i += 16) {
+            if (!all_set(vandq_u32(vandq_u32(equal4(i), equal4(i + 4)), vandq_u32(equal4(i + 8), equal4(i + 12))))) {
+                break;
+            }
+        }
+        for (; i + 4 <= nsamples; i += 4) {
+            if (!all_set(equal4(i))) {
+                break;
+            }
+        }
+#endif
+
+        // the tail, or the block holding the first difference
+        for (; i < nsamples; ++i) {
+            if (std::memcmp(a + i * SAMPLE_BYTES, b + i * SAMPLE_BYTES, SAMPLE_BYTES) != 0) {
+                break;
+            }
+        }
+        return i;
+    }
+
+    SecureReader::SecureReader(const CdRom &cd_rom) : cd_rom(cd_rom) {
+    }
+
+    std::expected<size_t, int> SecureReader::read_window(const size_t first_frame, const size_t nframes,
+                                                         const size_t range_first, const size_t range_end) {
+        const size_t before = std::min(SECURE_MARGIN_FRAMES, first_frame - range_first);
+        const size_t after = std::min(SECURE_MARGIN_FRAMES, range_end - (first_frame + nframes));
+        const size_t window_frames = before + nframes + after;
+
+        this->pass_buffer.resize(window_frames * CD_FRAMESIZE_RAW);
+        this->pass_c2.resize(window_frames * CD_C2_BYTES);
+        if (auto result = this->cd_rom.read_frames_c2(frames_to_msf_location(first_frame - before), window_frames,
+                                                      this->pass_buffer.data(), this->pass_c2.data()); !result) {
+            return std::unexpected(result.error());
+        }
+        return before;
+    }
+
+    std::expected<secure_read_result, int> SecureReader::read(const size_t first_frame, const size_t nframes,
+                                                              u_int8_t *buffer, const size_t range_first,
+                                                              const size_t range_end, const u_int8_t *anchor,
+                                                              u_int8_t *c2_pointers) {
+        AUDIPI_TRACE_NAMED_SPAN(span, "SecureReader::read");
+
+        secure_read_result result{0, 0, 0, false};
+        const size_t nsamples = nframes * SAMPLES_IN_FRAME;
+
+        // first pass: the reference, lined up against the anchor
+        const auto before = this->read_window(first_frame, nframes, range_first, range_end);
+        if (!before) {
+            return std::unexpected(before.error());
+        }
+
+        const size_t window_samples = this->pass_buffer.size() / SAMPLE_BYTES;
+        size_t start = before.value() * SAMPLES_IN_FRAME;
+        if (anchor != nullptr && before.value() > 0) {
+            const u_int8_t *anchor_tail = anchor + (SAMPLES_IN_FRAME - ALIGN_PROBE_SAMPLES) * SAMPLE_BYTES;
+            if (!is_constant(anchor_tail, ALIGN_PROBE_SAMPLES)) {
+                const size_t expected = start - ALIGN_PROBE_SAMPLES;
+                if (const auto found = find_run(this->pass_buffer.data(), window_samples, anchor_tail, expected);
+                    found && found.value() != expected && found.value() + ALIGN_PROBE_SAMPLES + nsamples
+                    <= window_samples) {
+                    start = found.value() + ALIGN_PROBE_SAMPLES;
+                    result.jitter_corrected = true;
+                }
+            }
+        }
+        std::memcpy(buffer, this->pass_buffer.data() + start * SAMPLE_BYTES, nsamples * SAMPLE_BYTES);
+        this->output_c2.resize(nframes * CD_C2_BYTES);
+        copy_c2(this->pass_c2.data(), start, this->output_c2.data(), nsamples);
+
+        this->verified.assign(nframes, false);
+        this->alternate_valid.assign(nframes, false);
+        this->alternates.resize(nframes * CD_FRAMESIZE_RAW);
+
+        // further passes over whatever is left unverified, until two reads agree on every frame
+        for (size_t pass = 1; pass < MAX_SECURE_PASSES; ++pass) {
+            const auto first_unverified = std::ranges::find(this->verified, false);
+            if (first_unverified == this->verified.end()) {
+                break;
+            }
+            const size_t lo = first_unverified - this->verified.begin();
+            const size_t hi = this->verified.rend() - std::ranges::find(this->verified.rbegin(),
+                                                                        this->verified.rend(), false);
+
+            const auto reread_before = this->read_window(first_frame + lo, hi - lo, range_first, range_end);
+            if (!reread_before) {
+                return std::unexpected(reread_before.error());
+            }
+            if (pass > 1) {
+                ++result.rereads;
+            }
+
+            // line the re-read up with the output, on a run that cannot match at the wrong shift
+            const size_t reread_samples = this->pass_buffer.size() / SAMPLE_BYTES;
+            long shift = 0;
+            for (size_t probe = lo * SAMPLES_IN_FRAME; probe + ALIGN_PROBE_SAMPLES <= hi * SAMPLES_IN_FRAME;
+                 probe += ALIGN_PROBE_SAMPLES) {
+                const u_int8_t *needle = buffer + probe * SAMPLE_BYTES;
+                if (is_constant(needle, ALIGN_PROBE_SAMPLES)) {
+                    continue;
+                }
+                const size_t expected = reread_before.value() * SAMPLES_IN_FRAME + probe - lo * SAMPLES_IN_FRAME;
+                if (const auto found = find_run(this->pass_buffer.data(), reread_samples, needle, expected)) {
+                    shift = static_cast<long>(found.value()) - static_cast<long>(expected);
+                    break;
+                }
+            }
+
+            for (size_t frame = lo; frame < hi; ++frame) {
+                if (this->verified[frame]) {
+                    continue;
+                }
+                const long index = static_cast<long>((reread_before.value() + frame - lo) * SAMPLES_IN_FRAME) + shift;
+                if (index < 0 || static_cast<size_t>(index) + SAMPLES_IN_FRAME > reread_samples) {
+                    continue;
+                }
+
+                if (is_damaged(this->pass_c2.data(), index, SAMPLES_IN_FRAME)) {
+                    // the drive itself says this read is wrong, it can neither confirm nor contradict another
+                    continue;
+                }
+
+                const u_int8_t *reread = this->pass_buffer.data() + index * SAMPLE_BYTES;
+                u_int8_t *output = buffer + frame * CD_FRAMESIZE_RAW;
+                u_int8_t *alternate = this->alternates.data() + frame * CD_FRAMESIZE_RAW;
+                u_int8_t *output_frame_c2 = this->output_c2.data() + frame * CD_C2_BYTES;
+                if (is_damaged(output_frame_c2, 0, SAMPLES_IN_FRAME)) {
+                    // a clean read replaces a damaged one outright, and still needs a second one to agree with it
+                    std::memcpy(output, reread, CD_FRAMESIZE_RAW);
+                    std::memset(output_frame_c2, 0, CD_C2_BYTES);
+                } else if (matching_samples(output, reread, SAMPLES_IN_FRAME) == SAMPLES_IN_FRAME) {
+                    this->verified[frame] = true;
+                } else if (this->alternate_valid[frame]
+                           && matching_samples(alternate, reread, SAMPLES_IN_FRAME) == SAMPLES_IN_FRAME) {
+                    // the first read was the odd one out
+                    std::memcpy(output, reread, CD_FRAMESIZE_RAW);
+                    this->verified[frame] = true;
+                } else {
+                    std::memcpy(alternate, reread, CD_FRAMESIZE_RAW);
+                    this->alternate_valid[frame] = true;
+                }
+            }
+        }
+
+        result.unverified_frames = std::ranges::count(this->verified, false);
+        for (size_t frame = 0; frame < nframes; ++frame) {
+            if (is_damaged(this->output_c2.data() + frame * CD_C2_BYTES, 0, SAMPLES_IN_FRAME)) {
+                ++result.damaged_frames;
+            }
+        }
+        if (c2_pointers != nullptr) {
+            std::memcpy(c2_pointers, this->output_c2.data(), nframes * CD_C2_BYTES);
+        }
+        AUDIPI_TRACE_SPAN_ARG(span, "rereads", result.rereads);
+        return result;
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef SECUREREADER_H
+#define SECUREREADER_H
+
+#include <expected>
+#include <vector>
+
+#include "CdRom.h"
+
+namespace audipi {
+    // frames read on each side of a batch, so that data shifted by jitter still covers it
+    constexpr size_t SECURE_MARGIN_FRAMES = 1;
+    // how far the drive may misplace a read, in samples
+    constexpr size_t MAX_JITTER_SAMPLES = SECURE_MARGIN_FRAMES * SAMPLES_IN_FRAME;
+    // length of the runs matched to align two reads
+    constexpr size_t ALIGN_PROBE_SAMPLES = 64;
+    // reads of any one batch, the first one included, before unverified frames are given up on
+    constexpr size_t MAX_SECURE_PASSES = 8;
+
+    struct secure_read_result {
+        size_t rereads; // passes over (part of) the batch beyond the one verifying the first read
+        size_t unverified_frames; // frames no two reads agreed on, returned as first read
+        size_t damaged_frames; // frames no read came back from without C2 errors, returned as last read
+        bool jitter_corrected; // the first read was misplaced, and moved back in line with anchor
+    };
+
+    /**
+    * @brief Number of leading stereo samples that are equal in a and b, compared up to 4 at a time with SSE2 or NEON
+    * where available.
+    */
+    [[nodiscard]] size_t matching_samples(const u_int8_t *a, const u_int8_t *b, size_t nsamples);
+
+    /**
+    * @brief Reads audio the way secure rippers do, for drives that misplace reads by a few samples (jitter) or
+    * return wrong data without reporting an error.
+    *
+    * Each batch is read with a margin around it and lined up against the frame before it (the anchor), then read
+    * again: a frame is only trusted once two reads, aligned to each other, agree on it. Frames that do not are
+    * re-read, up to MAX_SECURE_PASSES reads in all. A read the drive flags with C2 errors is never trusted: it only
+    * stands in for the frame until a clean one comes.
+    */
+    class SecureReader {
+        const CdRom &cd_rom;
+
+        std::vector<u_int8_t> pass_buffer;
+        std::vector<u_int8_t> pass_c2;
+        std::vector<u_int8_t> output_c2; // C2 pointers of what is in the output, per frame
+        std::vector<u_int8_t> alternates; // per frame, the last read that disagreed with the output
+        std::vector<bool> alternate_valid;
+        std::vector<bool> verified;
+
+        std::expected<size_t, int> read_window(size_t first_frame, size_t nframes, size_t range_first,
+                                               size_t range_end);
+
+    public:
+        explicit SecureReader(const CdRom &cd_rom);
+
+        SecureReader(const SecureReader &) = delete;
+        SecureReader &operator=(const SecureReader &) = delete;
+
+        /**
+        * @brief Reads nframes frames from absolute frame first_frame into buffer, never reading outside
+        * [range_first, range_end). anchor is the frame right before first_frame as previously read, if known:
+        * without it, the batch can only be verified, not put back in place. If c2_pointers is not null, it receives
+        * CD_C2_BYTES of C2 pointers per frame for what buffer holds, clear unless the frame is one of damaged_frames.
+        */
+        [[nodiscard]] std::expected<secure_read_result, int> read(size_t first_frame, size_t nframes,
+                                                                  u_int8_t *buffer, size_t range_first,
+                                                                  size_t range_end,
+                                                                  const u_int8_t *anchor = nullptr,
+                                                                  u_int8_t *c2_pointers = nullptr);
+    };
+}
+
+#endif //SECUREREADER_H
@@ -0,0 +1,78 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <sys/types.h>
+#include <type_traits>
+
+namespace audipi {
+    /**
+    * @brief Single-slot sequence lock: one writer at a time publishes a value, any number of readers copy it out
+    * without ever blocking the writer or each other. Readers retry if a store lands while they copy.
+    * The value is kept in atomic words, so that torn reads are detected rather than undefined.
+    */
+    template<typename T>
+    class SeqLock {
+        static_assert(std::is_trivially_copyable_v<T>, "SeqLock values are copied word by word");
+
+        static constexpr size_t WORDS = (sizeof(T) + sizeof(u_int64_t) - 1) / sizeof(u_int64_t);
+
+        // odd while a store is in progress, grows by 2 with every store
+        std::atomic<u_int64_t> sequence{0};
+        std::array<std::atomic<u_int64_t>, WORDS> words{};
+
+    public:
+        SeqLock() = default;
+
+        SeqLock(const SeqLock &) = delete;
+        SeqLock &operator=(const SeqLock &) = delete;
+
+        /**
+        * @brief Publishes value. Concurrent writers must be serialized by the caller.
+        */
+        void store(const T &value) {
+            std::array<u_int64_t, WORDS> raw{};
+            std::memcpy(raw.data(), &value, sizeof(T));
+
+            const u_int64_t current = sequence.load(std::memory_order_relaxed);
+            sequence.store(current + 1, std::memory_order_relaxed);
+            // release on each word: a reader that sees any of them also sees the odd sequence
+            for (size_t i = 0; i < WORDS; ++i) {
+                words[i].store(raw[i], std::memory_order_release);
+            }
+            sequence.store(current + 2, std::memory_order_release);
+        }
+
+        /**
+        * @brief Copies out the last published value, value-initialized T if nothing was published yet.
+        */
+        [[nodiscard]] T load() const {
+            std::array<u_int64_t, WORDS> raw{};
+            u_int64_t before, after;
+            do {
+                before = sequence.load(std::memory_order_acquire);
+                // acquire on each word: the second sequence load cannot move before them
+                for (size_t i = 0; i < WORDS; ++i) {
+                    raw[i] = words[i].load(std::memory_order_acquire);
+                }
+                after = sequence.load(std::memory_order_relaxed);
+            } while (before != after || (before & 1) != 0);
+
+            T value{};
+            // trivially copyable is all it takes, even with a non-trivial default constructor
+            std::memcpy(static_cast<void *>(&value), raw.data(), sizeof(T));
+            return value;
+        }
+
+        /**
+        * @brief Number of stores so far, so that readers can tell cheaply whether anything was published since.
+        */
+        [[nodiscard]] u_int64_t version() const {
+            return sequence.load(std::memory_order_acquire) / 2;
+        }
+    };
+}
+
+#endif //SEQLOCK_H
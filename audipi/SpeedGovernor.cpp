@@ -0,0 +1,83 @@
+#include "SpeedGovernor.h"
+
+#include <cerrno>
+
+#include "Trace.h"
+
+namespace {
+    // the drive or its driver cannot select speeds at all, as opposed to a command that failed this once
+    bool is_unsupported(const int error) {
+        return error == ENOSYS || error == EINVAL || error == ENOTTY;
+    }
+}
+
+namespace audipi {
+    // starts out assuming the drive is at its default, the fastest speed, which an empty read-ahead needs anyway
+    SpeedGovernor::SpeedGovernor(const CdRom &cd_rom, speed_governor_config config, PlayerMetrics *metrics)
+        : cd_rom(cd_rom), config(std::move(config)), metrics(metrics), speed_index(this->config.speeds.size() - 1),
+          disabled(this->config.speeds.empty()) {
+    }
+
+    void SpeedGovernor::select(const size_t index, const std::chrono::steady_clock::time_point now) {
+        const unsigned int speed = this->config.speeds[index];
+        if (const auto result = this->cd_rom.select_speed(speed); !result) {
+            // anything else, e.g. a busy drive, is tried again at the next update
+            if (is_unsupported(result.error())) {
+                this->disabled = true;
+                AUDIPI_TRACE_INSTANT("SpeedGovernor::unsupported", "error", result.error());
+            } else {
+                AUDIPI_TRACE_INSTANT("SpeedGovernor::select_error", "error", result.error());
+            }
+            return;
+        }
+
+        AUDIPI_TRACE_INSTANT("SpeedGovernor::select", "speed", speed);
+        this->speed_index = index;
+        this->last_change = now;
+        this->full_since = now;
+        if (this->metrics != nullptr) {
+            this->metrics->speed_changes.fetch_add(1, std::memory_order_relaxed);
+            this->metrics->drive_speed.store(speed, std::memory_order_relaxed);
+        }
+    }
+
+    void SpeedGovernor::update(const size_t fill_frames, const size_t target_frames, const bool starving) {
+        std::lock_guard lg(this->mutex);
+        if (this->disabled) {
+            return;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        const size_t fastest = this->config.speeds.size() - 1;
+
+        if (starving) {
+            this->full = false;
+            if (this->speed_index != fastest) {
+                this->select(fastest, now);
+            }
+            return;
+        }
+
+        if (static_cast<double>(fill_frames) >= this->config.high_fill * static_cast<double>(target_frames)) {
+            // keeping up: try a notch slower once it has been so for a while
+            if (!this->full) {
+                this->full = true;
+                this->full_since = now;
+            } else if (this->speed_index > 0 && now - this->full_since >= this->config.step_down_after) {
+                this->select(this->speed_index - 1, now);
+            }
+            return;
+        }
+
+        this->full = false;
+        if (static_cast<double>(fill_frames) < this->config.low_fill * static_cast<double>(target_frames)
+            && this->speed_index < fastest && now - this->last_change >= this->config.step_up_after) {
+            this->select(this->speed_index + 1, now);
+        }
+    }
+
+    unsigned int SpeedGovernor::get_speed() {
+        std::lock_guard lg(this->mutex);
+        return this->config.speeds.empty() ? 0 : this->config.speeds[this->speed_index];
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef SPEEDGOVERNOR_H
+#define SPEEDGOVERNOR_H
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "CdRom.h"
+#include "PlayerMetrics.h"
+
+namespace audipi {
+    struct speed_governor_config {
+        std::vector<unsigned int> speeds = {2, 4, 8, 0}; // ascending, 0 stands for the drive's maximum
+        double low_fill = 0.5; // fraction of the read-ahead target below which the drive speeds up
+        double high_fill = 0.9; // fraction of the read-ahead target above which it counts as full
+        std::chrono::milliseconds step_up_after{1000}; // least time between two steps up
+        std::chrono::milliseconds step_down_after{10000}; // how long the read-ahead has to stay full to step down
+    };
+
+    /**
+    * @brief Picks the drive speed from how far the read-ahead is ahead of playback: the slowest speed that keeps it
+    * full, so that the drive spins quietly and steadily instead of racing ahead, idling and spinning down; and the
+    * fastest one right away when playback is about to run dry, e.g. after a seek or a cache miss.
+    * Gives up for good if the drive does not support CDROM_SELECT_SPEED (ENOSYS, EINVAL or ENOTTY), and tries again
+    * later on any other error.
+    */
+    class SpeedGovernor {
+        const CdRom &cd_rom;
+        const speed_governor_config config;
+        PlayerMetrics *metrics;
+
+        std::mutex mutex;
+        size_t speed_index;
+        std::chrono::steady_clock::time_point last_change;
+        std::chrono::steady_clock::time_point full_since;
+        bool full = false;
+        bool disabled = false;
+
+        void select(size_t index, std::chrono::steady_clock::time_point now);
+
+    public:
+        SpeedGovernor(const CdRom &cd_rom, speed_governor_config config, PlayerMetrics *metrics = nullptr);
+
+        SpeedGovernor(const SpeedGovernor &) = delete;
+        SpeedGovernor &operator=(const SpeedGovernor &) = delete;
+
+        /**
+        * @brief Reports fill_frames ready ahead of the play cursor, out of the target_frames the read-ahead aims for,
+        * and whether playback is about to run dry. Changes the drive speed if needed.
+        */
+        void update(size_t fill_frames, size_t target_frames, bool starving);
+
+        /**
+        * @brief Speed selected last, 0 for the drive's maximum.
+        */
+        [[nodiscard]] unsigned int get_speed();
+    };
+}
+
+#endif //SPEEDGOVERNOR_H
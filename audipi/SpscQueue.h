@@ -0,0 +1,96 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <vector>
+
+namespace audipi {
+    /**
+    * @brief Wait-free single-producer/single-consumer queue over a preallocated ring of slots.
+    * Slots are filled and drained in place: the producer writes into producer_slot() and publishes it with push(),
+    * the consumer reads front() and releases it with pop(). Neither side ever blocks or allocates.
+    */
+    template<typename T>
+    class SpscQueue {
+        static constexpr size_t CACHE_LINE_SIZE = 64;
+
+        std::vector<T> slots;
+
+        // indices grow monotonically, slot = index % slots.size()
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> head{0}; // next slot to read, written by the consumer
+        alignas(CACHE_LINE_SIZE) size_t cached_tail = 0; // consumer's last view of tail
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail{0}; // next slot to write, written by the producer
+        alignas(CACHE_LINE_SIZE) size_t cached_head = 0; // producer's last view of head
+
+    public:
+        explicit SpscQueue(const size_t capacity) : slots(capacity) {
+        }
+
+        SpscQueue(const SpscQueue &) = delete;
+        SpscQueue &operator=(const SpscQueue &) = delete;
+
+        /**
+        * @brief Producer side: slot to fill next, or nullptr if the queue is full.
+        */
+        T *producer_slot() {
+            const size_t current_tail = tail.load(std::memory_order_relaxed);
+            if (current_tail - cached_head == slots.size()) {
+                cached_head = head.load(std::memory_order_acquire);
+                if (current_tail - cached_head == slots.size()) {
+                    return nullptr;
+                }
+            }
+            return &slots[current_tail % slots.size()];
+        }
+
+        /**
+        * @brief Producer side: publishes the slot returned by producer_slot().
+        */
+        void push() {
+            tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        /**
+        * @brief Consumer side: oldest published slot, or nullptr if the queue is empty.
+        */
+        T *front() {
+            const size_t current_head = head.load(std::memory_order_relaxed);
+            if (current_head == cached_tail) {
+                cached_tail = tail.load(std::memory_order_acquire);
+                if (current_head == cached_tail) {
+                    return nullptr;
+                }
+            }
+            return &slots[current_head % slots.size()];
+        }
+
+        /**
+        * @brief Consumer side: hands the slot returned by front() back to the producer.
+        */
+        void pop() {
+            head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        [[nodiscard]] size_t size() const {
+            // head first: tail only grows, so the difference can never go negative
+            const size_t current_head = head.load(std::memory_order_acquire);
+            return tail.load(std::memory_order_acquire) - current_head;
+        }
+
+        [[nodiscard]] size_t capacity() const {
+            return slots.size();
+        }
+
+        /**
+        * @brief Empties the queue. Only safe while neither the producer nor the consumer is using it.
+        */
+        void clear() {
+            head.store(0, std::memory_order_relaxed);
+            tail.store(0, std::memory_order_relaxed);
+            cached_head = 0;
+            cached_tail = 0;
+        }
+    };
+}
+
+#endif //SPSCQUEUE_H
@@ -0,0 +1,177 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include "SeqLock.h"
+
+// events kept per thread, the oldest are overwritten
+constexpr size_t RING_EVENTS = 16384;
+constexpr u_int64_t INSTANT = static_cast<u_int64_t>(-1);
+
+namespace {
+    struct trace_event {
+        u_int64_t index; // position in the ring's event sequence, tells a reused slot apart
+        const char *name;
+        const char *arg_name;
+        u_int64_t arg;
+        u_int64_t start_ns;
+        u_int64_t end_ns; // INSTANT for point events
+    };
+
+    struct thread_ring {
+        // the owning thread is the only writer and never waits, an export copies each slot out as its seqlock allows
+        std::array<audipi::SeqLock<trace_event>, RING_EVENTS> events;
+        std::atomic<u_int64_t> written{0};
+        std::atomic<const char *> thread_name{nullptr};
+        size_t thread_id = 0;
+    };
+
+    std::mutex registry_mutex;
+    std::vector<std::shared_ptr<thread_ring>> registry;
+
+    const auto trace_epoch = std::chrono::steady_clock::now();
+
+    // set by set_thread_name, handed to the ring once the thread records its first event
+    thread_local const char *current_thread_name = nullptr;
+    // allocated on the first event, so that threads of a player that never traces do not carry a ring
+    thread_local std::shared_ptr<thread_ring> current_ring;
+
+    thread_ring &ring_for_current_thread() {
+        if (!current_ring) {
+            auto new_ring = std::make_shared<thread_ring>();
+            new_ring->thread_name.store(current_thread_name, std::memory_order_relaxed);
+
+            std::lock_guard lg(registry_mutex);
+            new_ring->thread_id = registry.size() + 1;
+            registry.push_back(new_ring);
+            current_ring = std::move(new_ring);
+        }
+        return *current_ring;
+    }
+
+    void push(trace_event event) {
+        auto &ring = ring_for_current_thread();
+
+        event.index = ring.written.load(std::memory_order_relaxed);
+        ring.events[event.index % RING_EVENTS].store(event);
+        ring.written.store(event.index + 1, std::memory_order_release);
+    }
+
+    void append_escaped(std::ostringstream &out, const std::string &text) {
+        for (const char c: text) {
+            if (c == '"' || c == '\\') {
+                out << '\\';
+            }
+            out << c;
+        }
+    }
+}
+
+namespace audipi::trace {
+    std::atomic<bool> enabled{false};
+
+    void set_enabled(const bool enable) {
+        enabled.store(enable, std::memory_order_relaxed);
+    }
+
+    void set_thread_name(const char *name) {
+        current_thread_name = name;
+        if (current_ring) {
+            current_ring->thread_name.store(name, std::memory_order_relaxed);
+        }
+    }
+
+    u_int64_t now_ns() {
+        // never 0, which Span uses for "not started"
+        return static_cast<u_int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - trace_epoch).count()) + 1;
+    }
+
+    void record(const char *name, const u_int64_t start_ns, const u_int64_t end_ns, const char *arg_name,
+                const u_int64_t arg) {
+        push({0, name, arg_name, arg, start_ns, end_ns});
+    }
+
+    void instant(const char *name, const char *arg_name, const u_int64_t arg) {
+        if (!is_enabled()) {
+            return;
+        }
+        push({0, name, arg_name, arg, now_ns(), INSTANT});
+    }
+
+    std::string export_chrome_json() {
+        std::vector<std::shared_ptr<thread_ring>> rings;
+        {
+            std::lock_guard lg(registry_mutex);
+            rings = registry;
+        }
+
+        std::ostringstream out;
+        out << "{\"traceEvents\":[";
+        bool first = true;
+        const auto separator = [&] {
+            if (!first) {
+                out << ",\n";
+            }
+            first = false;
+        };
+
+        for (const auto &ring: rings) {
+            const char *thread_name = ring->thread_name.load(std::memory_order_relaxed);
+
+            separator();
+            out << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << ring->thread_id << R"(,"args":{"name":")";
+            append_escaped(out, thread_name == nullptr ? "thread " + std::to_string(ring->thread_id) : thread_name);
+            out << "\"}}";
+
+            const u_int64_t written = ring->written.load(std::memory_order_acquire);
+            const u_int64_t count = std::min<u_int64_t>(written, RING_EVENTS);
+            for (u_int64_t i = written - count; i < written; ++i) {
+                const auto event = ring->events[i % RING_EVENTS].load();
+                if (event.index != i) {
+                    // overwritten by a newer event while exporting
+                    continue;
+                }
+
+                separator();
+                out << R"({"name":")" << event.name << R"(","pid":1,"tid":)" << ring->thread_id
+                        << R"(,"ts":)" << static_cast<double>(event.start_ns) / 1000.0;
+                if (event.end_ns == INSTANT) {
+                    out << R"(,"ph":"i","s":"t")";
+                } else {
+                    out << R"(,"ph":"X","dur":)" << static_cast<double>(event.end_ns - event.start_ns) / 1000.0;
+                }
+                if (event.arg_name != nullptr) {
+                    out << R"(,"args":{")" << event.arg_name << "\":" << event.arg << "}";
+                }
+                out << "}";
+            }
+        }
+
+        out << "]}\n";
+        return out.str();
+    }
+
+    std::expected<void, int> write_chrome_json(const std::string &path) {
+        const std::string contents = export_chrome_json();
+
+        FILE *file = fopen(path.c_str(), "w");
+        if (file == nullptr) {
+            return std::unexpected(errno);
+        }
+
+        const bool written = fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+        const int error = errno;
+        if (fclose(file) != 0 || !written) {
+            return std::unexpected(written ? errno : error);
+        }
+        return {};
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <expected>
+#include <string>
+
+namespace audipi::trace {
+    extern std::atomic<bool> enabled;
+
+    /**
+    * @brief Starts or stops recording. Off by default: a disabled span only costs a relaxed load.
+    */
+    void set_enabled(bool enable);
+
+    [[nodiscard]] inline bool is_enabled() {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+    * @brief Names the calling thread in exported traces. name must be a string literal. Allocates nothing: the
+    * thread's event ring is only set up once it records its first event.
+    */
+    void set_thread_name(const char *name);
+
+    [[nodiscard]] u_int64_t now_ns();
+
+    /**
+    * @brief Records a completed span into the calling thread's ring. name and arg_name must be string literals.
+    */
+    void record(const char *name, u_int64_t start_ns, u_int64_t end_ns, const char *arg_name, u_int64_t arg);
+
+    /**
+    * @brief Records a point in time, e.g. an underrun or a read error.
+    */
+    void instant(const char *name, const char *arg_name = nullptr, u_int64_t arg = 0);
+
+    /**
+    * @brief Times the enclosing scope, if tracing was enabled when it started.
+    */
+    class Span {
+        const char *name;
+        const char *arg_name = nullptr;
+        u_int64_t arg = 0;
+        u_int64_t start_ns = 0;
+
+    public:
+        explicit Span(const char *name) : name(name) {
+            if (is_enabled()) {
+                start_ns = now_ns();
+            }
+        }
+
+        ~Span() {
+            if (start_ns != 0) {
+                record(name, start_ns, now_ns(), arg_name, arg);
+            }
+        }
+
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+
+        void set_arg(const char *arg_name, const u_int64_t arg) {
+            this->arg_name = arg_name;
+            this->arg = arg;
+        }
+    };
+
+    /**
+    * @brief Everything still in the rings of all threads, as Chrome trace-event JSON (chrome://tracing, Perfetto).
+    */
+    [[nodiscard]] std::string export_chrome_json();
+
+    [[nodiscard]] std::expected<void, int> write_chrome_json(const std::string &path);
+}
+
+#define AUDIPI_TRACE_CONCAT_INNER(a, b) a##b
+#define AUDIPI_TRACE_CONCAT(a, b) AUDIPI_TRACE_CONCAT_INNER(a, b)
+
+#if AUDIPI_TRACE
+#define AUDIPI_TRACE_SPAN(name) audipi::trace::Span AUDIPI_TRACE_CONCAT(audipi_trace_span_, __LINE__)(name)
+#define AUDIPI_TRACE_NAMED_SPAN(variable, name) audipi::trace::Span variable(name)
+#define AUDIPI_TRACE_SPAN_ARG(variable, arg_name, arg) (variable).set_arg(arg_name, arg)
+#define AUDIPI_TRACE_INSTANT(...) audipi::trace::instant(__VA_ARGS__)
+#else
+#define AUDIPI_TRACE_SPAN(name) do {} while (false)
+#define AUDIPI_TRACE_NAMED_SPAN(variable, name) do {} while (false)
+#define AUDIPI_TRACE_SPAN_ARG(variable, arg_name, arg) do {} while (false)
+#define AUDIPI_TRACE_INSTANT(...) do {} while (false)
+#endif
+
+#endif //TRACE_H
@@ -0,0 +1,159 @@
+#include "TrackReader.h"
+
+#include <chrono>
+
+#include "Trace.h"
+
+constexpr auto ERROR_BACKOFF = std::chrono::milliseconds(200);
+
+namespace audipi {
+    TrackReader::TrackReader(const size_t read_ahead_frames)
+        : read_ahead_frames(read_ahead_frames), thread(&TrackReader::run, this) {
+    }
+
+    TrackReader::~TrackReader() {
+        {
+            std::lock_guard lg(this->mutex);
+            this->running = false;
+            ++this->wakeups;
+        }
+        this->wakeup.notify_one();
+        this->thread.join();
+    }
+
+    void TrackReader::set_track(PlayerTrack *track, const track_neighbours neighbours, PlayerTrack *following) {
+        {
+            std::unique_lock lock(this->mutex);
+            this->track = track;
+            this->neighbours = neighbours;
+            this->following = following;
+            ++this->wakeups;
+            this->read_done.wait(lock, [&] {
+                return this->reading == nullptr || (this->reading == track && this->reading != this->finished);
+            });
+            this->reset_finished();
+        }
+        this->wakeup.notify_one();
+    }
+
+    void TrackReader::advance_to(PlayerTrack *track, const track_neighbours neighbours, PlayerTrack *following,
+                                 PlayerTrack *finished) {
+        {
+            std::lock_guard lg(this->mutex);
+            this->track = track;
+            this->neighbours = neighbours;
+            this->following = following;
+            this->finished = finished;
+            ++this->wakeups;
+        }
+        this->wakeup.notify_one();
+    }
+
+    void TrackReader::reset_finished() {
+        if (this->finished != nullptr) {
+            this->finished->reset();
+            this->finished = nullptr;
+        }
+    }
+
+    void TrackReader::set_read_ahead_frames(const size_t frames) {
+        {
+            std::lock_guard lg(this->mutex);
+            this->read_ahead_frames = frames;
+            ++this->wakeups;
+        }
+        this->wakeup.notify_one();
+    }
+
+    void TrackReader::notify() {
+        // without the lock, which the output thread must not wait for: a notification landing right before the
+        // reader goes to sleep is only picked up with the next one, one refill later
+        this->wakeups.fetch_add(1, std::memory_order_relaxed);
+        this->wakeup.notify_one();
+    }
+
+    void TrackReader::run() {
+        trace::set_thread_name("read-ahead");
+        std::unique_lock lock(this->mutex);
+
+        while (this->running) {
+            this->reset_finished();
+
+            if (this->track == nullptr && this->neighbours == track_neighbours{}) {
+                this->wakeup.wait(lock);
+                continue;
+            }
+
+            const u_int64_t seen_wakeups = this->wakeups.load(std::memory_order_relaxed);
+            PlayerTrack *current = this->track;
+            const auto frames = this->read_ahead_frames;
+            std::expected<bool, int> result = false;
+            PlayerTrack *last_read = current; // whose read the result is
+
+            if (current != nullptr) {
+                this->reading = current;
+
+                lock.unlock();
+                result = current->read_ahead(frames);
+                lock.lock();
+
+                this->reading = nullptr;
+                this->read_done.notify_all();
+            }
+
+            // once the playing track is read to its end, the next one starts filling its queue behind it
+            // unless the output thread moved on during the read, the following track is now another one's
+            if (result && !result.value() && current != nullptr && current == this->track
+                && this->following != nullptr && current->is_read_complete()) {
+                PlayerTrack *next = this->following;
+                this->reading = next;
+                last_read = next;
+
+                lock.unlock();
+                result = next->read_ahead(frames);
+                lock.lock();
+
+                this->reading = nullptr;
+                this->read_done.notify_all();
+            }
+
+            // the playing track always comes first, neighbours only get the time it does not need
+            for (size_t i = 0; result && !result.value() && i < this->neighbours.size(); ++i) {
+                PlayerTrack *neighbour = this->neighbours[i];
+                if (neighbour == nullptr) {
+                    continue;
+                }
+                this->reading = neighbour;
+                last_read = neighbour;
+
+                lock.unlock();
+                result = neighbour->prefetch_start(NEIGHBOUR_PREFETCH_FRAMES);
+                lock.lock();
+
+                this->reading = nullptr;
+                this->read_done.notify_all();
+            }
+
+            if (!result) {
+                AUDIPI_TRACE_INSTANT("TrackReader::read_error", "error", result.error());
+                if (const auto retry_delay = last_read->get_retry_delay(); retry_delay < ERROR_BACKOFF) {
+                    // a read playback is waiting for: the play cursor cannot move past it, only a track change ends
+                    // the pause before the retry early
+                    this->wakeup.wait_for(lock, retry_delay, [&] {
+                        return !this->running || this->track != current;
+                    });
+                } else {
+                    // a read further ahead must not keep the queue from being fed meanwhile
+                    this->wakeup.wait_for(lock, ERROR_BACKOFF, [&] {
+                        return !this->running || this->wakeups.load(std::memory_order_relaxed) != seen_wakeups;
+                    });
+                }
+            } else if (!result.value() && this->finished == nullptr) {
+                // everything is read and prefetched: nothing to do until the play cursor moves or the tracks change
+                this->wakeup.wait(lock, [&] {
+                    return this->wakeups.load(std::memory_order_relaxed) != seen_wakeups;
+                });
+            }
+        }
+    }
+}
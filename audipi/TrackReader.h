@@ -0,0 +1,76 @@
+#ifndef TRACKREADER_H
+#define TRACKREADER_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "PlayerTrack.h"
+
+namespace audipi {
+    // tracks to prefetch the start of, in order of priority, nullptr where there is none
+    using track_neighbours = std::array<PlayerTrack *, 2>;
+
+    /**
+    * @brief Background thread keeping the cache of the playing track filled ahead of its play cursor,
+    * so that the playback path never has to wait for the drive.
+    * Once the playing track is read far enough ahead, it prefetches the start of the tracks likely to be played next,
+    * and once it is read to its end, it pre-rolls the track that follows it so that playback can continue gaplessly.
+    */
+    class TrackReader {
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        std::condition_variable read_done;
+
+        PlayerTrack *track = nullptr;
+        track_neighbours neighbours{};
+        PlayerTrack *following = nullptr; // played right after track
+        PlayerTrack *finished = nullptr; // to be reset once no read is in progress on it
+        PlayerTrack *reading = nullptr; // track with a read in progress, outside the lock
+        size_t read_ahead_frames;
+        bool running = true;
+        // bumped by every notification, so that an idle reader only sleeps until something changed since it looked
+        std::atomic<u_int64_t> wakeups{0};
+
+        std::thread thread;
+
+        void run();
+
+        // with the lock held, while no read is in progress on the finished track
+        void reset_finished();
+
+    public:
+        explicit TrackReader(size_t read_ahead_frames);
+        ~TrackReader();
+
+        TrackReader(const TrackReader &) = delete;
+        TrackReader &operator=(const TrackReader &) = delete;
+
+        /**
+        * @brief Switches the reader to another track (or nullptr to only prefetch the neighbours, or to idle).
+        * Blocks until any read in progress on other tracks has completed.
+        * The following track has its playback queue filled ahead of time, so it must be at its start and must not
+        * be reset while the reader is on it.
+        */
+        void set_track(PlayerTrack *track, track_neighbours neighbours = {}, PlayerTrack *following = nullptr);
+
+        /**
+        * @brief Moves the reader on from a finished track to the one following it, without waiting for a read in
+        * progress: the output thread calls it at the track boundary and must not wait for the drive.
+        * The finished track is reset by the reader once it lets go of it, or by the next set_track().
+        */
+        void advance_to(PlayerTrack *track, track_neighbours neighbours, PlayerTrack *following,
+                        PlayerTrack *finished);
+
+        void set_read_ahead_frames(size_t frames);
+
+        /**
+        * @brief Wakes the reader up after the play cursor moved.
+        */
+        void notify();
+    };
+}
+
+#endif //TRACKREADER_H
@@ -16,6 +16,23 @@ namespace audipi {
         mixed = CDS_MIXED,
         unsupported = -1
     };
+
+    /**
+    * @brief How often audio reads also poll the drive's Q subchannel (track, index and position).
+    */
+    enum class subchannel_mode {
+        none, // never, audio data only
+        per_batch, // once after each multi-frame read
+        per_frame // after every frame, reading one frame per command
+    };
+
+    /**
+    * @brief How much audio reads trust the drive.
+    */
+    enum class read_mode {
+        fast, // every frame is read once, as the drive returns it
+        secure // every frame is read until two reads agree, and realigned if the drive misplaced it
+    };
 }
 
 #endif //ENUMS_H
@@ -138,4 +138,20 @@ namespace audipi {
     bool operator==(const msf_location &left, const msf_location &right) {
         return left.minute == right.minute && left.second == right.second && left.frame == right.frame;
     }
+
+    size_t msf_location_to_frames(const msf_location &location) {
+        return (static_cast<size_t>(location.minute) * SEC_LIMIT + location.second) * FRAME_LIMIT + location.frame;
+    }
+
+    msf_location frames_to_msf_location(const size_t frames) {
+        return {
+            static_cast<u_int8_t>(frames / FRAME_LIMIT / SEC_LIMIT),
+            static_cast<u_int8_t>(frames / FRAME_LIMIT % SEC_LIMIT),
+            static_cast<u_int8_t>(frames % FRAME_LIMIT)
+        };
+    }
+
+    size_t msfs_location_to_samples(const msfs_location &location) {
+        return msf_location_to_frames(location) * SAMPLE_LIMIT + location.samples;
+    }
 }
@@ -50,6 +50,21 @@ namespace audipi {
 
     bool operator==(const msf_location& left, const msf_location& right);
 
+    /**
+    * @brief Converts an MSF location to the number of frames it spans from 00:00:00.
+    */
+    size_t msf_location_to_frames(const msf_location& location);
+
+    /**
+    * @brief Converts a number of frames from 00:00:00 to an MSF location.
+    */
+    msf_location frames_to_msf_location(size_t frames);
+
+    /**
+    * @brief Converts an MSFS location to the number of samples it spans from 00:00:00.0.
+    */
+    size_t msfs_location_to_samples(const msfs_location& location);
+
     struct disk_toc_entry {
         u_int8_t track_num;
         msf_location address;
@@ -62,6 +77,13 @@ namespace audipi {
         std::vector<disk_toc_entry> entries;
     };
 
+    struct subchannel_position {
+        u_int8_t track_num;
+        u_int8_t index_num;
+        msf_location location_abs;
+        msf_location location_rel;
+    };
+
     struct cd_audio_frame {
         u_int8_t track_num;
         u_int8_t index_num;
@@ -0,0 +1,82 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstdio>
+
+namespace audipi::bench {
+    /**
+    * @brief Number of heap allocations made by the process so far.
+    */
+    size_t allocation_count();
+
+    /**
+    * @brief Keeps the compiler from optimizing away a value computed inside a benchmark.
+    */
+    template<typename T>
+    void do_not_optimize(const T &value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    inline void report(const char *name, const double ns_per_op, const double allocations_per_op) {
+        printf("%-48s %12.1f ns/op %10.3f allocs/op\n", name, ns_per_op, allocations_per_op);
+    }
+
+    /**
+    * @brief Runs body(i) for i in [0, iterations) and reports the average time and allocations per iteration.
+    */
+    template<typename Body>
+    void run(const char *name, const size_t iterations, Body &&body) {
+        const size_t allocations_before = allocation_count();
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            body(i);
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        const size_t allocations = allocation_count() - allocations_before;
+
+        const double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+        report(name, ns / static_cast<double>(iterations),
+               static_cast<double>(allocations) / static_cast<double>(iterations));
+    }
+
+    void structs();
+
+    void sample_buffer();
+
+    void playback_path();
+
+    /**
+    * @brief Time from the TOC being read to the first sample being ready, with a drive of realistic latency.
+    */
+    void startup_latency();
+
+    /**
+    * @brief Time from a seek to audio at the target being ready, on a drive with seek-time modelling.
+    */
+    void seek();
+
+    /**
+    * @brief The whole playback path, from the fake drive through Player::tick() into a NullSink, flat out.
+    */
+    void player();
+
+    /**
+    * @brief Secure reads against a drive that misplaces reads and flips bits, compared to plain reads. Returns false if
+    * secure reads got any sample wrong.
+    */
+    bool secure_read();
+
+    /**
+    * @brief Host-side cost of READ CD commands, against a fake SG_IO transport.
+    */
+    void scsi_read();
+
+    /**
+    * @brief Drive speed and spin-ups over a minute of playback on a simulated spinning drive, with and without the
+    * speed governor. Returns false if playback stalled more with the governor than without it.
+    */
+    bool speed_control();
+}
+
+#endif //BENCH_H
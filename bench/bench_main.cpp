@@ -0,0 +1,43 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "bench.h"
+
+namespace {
+    std::atomic<size_t> allocations{0};
+}
+
+void *operator new(const size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+size_t audipi::bench::allocation_count() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+int main() {
+    audipi::bench::structs();
+    audipi::bench::sample_buffer();
+    audipi::bench::playback_path();
+    audipi::bench::startup_latency();
+    audipi::bench::seek();
+    audipi::bench::player();
+    const bool secure_read_correct = audipi::bench::secure_read();
+    audipi::bench::scsi_read();
+    const bool speed_control_kept_up = audipi::bench::speed_control();
+
+    return secure_read_correct && speed_control_kept_up ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+#include <algorithm>
+
+#include "bench.h"
+#include "../testing/FakeCdRom.h"
+#include "../audipi/PlayerTrack.h"
+#include "../audipi/TrackReader.h"
+
+// the amount an audio device typically asks for per wakeup
+constexpr size_t PERIOD_SAMPLES = 1024;
+
+namespace audipi::bench {
+    void playback_path() {
+        testing::FakeCdRom cd_rom;
+        const disk_toc_entry toc_entry{1, {0, 2, 0}, {10, 0, 0}};
+        const size_t track_samples = msf_location_to_frames(toc_entry.duration) * SAMPLES_IN_FRAME;
+
+        CdPlayerTrack track(cd_rom, toc_entry, SampleBuffer::for_disc({1, 1, {toc_entry}}, 30 * 75 * CD_FRAMESIZE_RAW));
+        TrackReader reader(5 * 75);
+        reader.set_track(&track);
+
+        // steady state only: the track and the reader have done all of their allocations by now
+        size_t consumed = 0;
+        size_t stalls = 0;
+        const size_t allocations_before = allocation_count();
+        const auto start = std::chrono::steady_clock::now();
+
+        while (consumed < track_samples) {
+            size_t period = std::min(PERIOD_SAMPLES, track_samples - consumed);
+            while (period > 0) {
+                const auto samples = track.peek_samples();
+                if (!samples || samples->empty()) {
+                    ++stalls;
+                    reader.notify();
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                const auto run = samples->first(std::min(samples->size(), period));
+                do_not_optimize(run.data());
+                track.consume_samples(run.size());
+                period -= run.size();
+                consumed += run.size();
+            }
+            reader.notify();
+        }
+
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        const size_t allocations = allocation_count() - allocations_before;
+        reader.set_track(nullptr);
+
+        const double frames = static_cast<double>(track_samples) / SAMPLES_IN_FRAME;
+        report("peek/consume per frame, fake drive",
+               std::chrono::duration<double, std::nano>(elapsed).count() / frames,
+               static_cast<double>(allocations) / frames);
+        printf("%-48s %12zu times the consumer overtook the reader\n", "", stalls);
+
+        // synchronous prefetch through the batched read path, each run starting from a cold cache
+        {
+            CdPlayerTrack cold_track(cd_rom, toc_entry, SampleBuffer::for_disc({1, 1, {toc_entry}},
+                                                                               track_samples * 4));
+            const size_t prefetch_allocations_before = allocation_count();
+            const auto prefetch_start = std::chrono::steady_clock::now();
+            cold_track.prefetch_samples(track_samples);
+            const auto prefetch_elapsed = std::chrono::steady_clock::now() - prefetch_start;
+
+            const double track_frames = static_cast<double>(track_samples) / SAMPLES_IN_FRAME;
+            report("prefetch_samples per frame, fake drive",
+                   std::chrono::duration<double, std::nano>(prefetch_elapsed).count() / track_frames,
+                   static_cast<double>(allocation_count() - prefetch_allocations_before) / track_frames);
+        }
+    }
+}
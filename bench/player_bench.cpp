@@ -0,0 +1,42 @@
+#include "bench.h"
+#include "../testing/FakeCdRom.h"
+#include "../audipi/NullSink.h"
+#include "../audipi/Player.h"
+
+constexpr auto PLAY_TIME = std::chrono::seconds(2);
+
+namespace audipi::bench {
+    void player() {
+        // the null sink takes samples as fast as they come, so this measures the whole path flat out
+        Player player(std::make_unique<NullSink>());
+        player.set_persistent_cache("", 0);
+
+        testing::FakeCdRom cd_rom;
+        const disk_toc toc{1, 1, {{1, {0, 2, 0}, {70, 0, 0}}}};
+        player.enqueue_cd(cd_rom, toc);
+        player.play();
+
+        const size_t allocations_before = allocation_count();
+        const auto start = std::chrono::steady_clock::now();
+        size_t ticks = 0;
+        while (std::chrono::steady_clock::now() - start < PLAY_TIME) {
+            player.tick();
+            ++ticks;
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        const size_t allocations = allocation_count() - allocations_before;
+
+        const auto location = player.get_status().current_location_in_track;
+        player.stop();
+
+        const auto frames = static_cast<double>(msf_location_to_frames(location));
+        if (frames == 0) {
+            printf("%-48s no frames played\n", "Player::tick() into null sink");
+            return;
+        }
+        report("Player::tick() into null sink",
+               std::chrono::duration<double, std::nano>(elapsed).count() / frames,
+               static_cast<double>(allocations) / frames);
+        printf("%-48s %12zu ticks, %.0f frames\n", "", ticks, frames);
+    }
+}
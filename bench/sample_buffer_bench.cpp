@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <linux/cdrom.h>
+#include <map>
+#include <mutex>
+#include <set>
+
+#include "bench.h"
+#include "../audipi/SampleBuffer.h"
+
+constexpr size_t CACHE_FRAMES = 30 * 75;
+constexpr size_t READ_AHEAD_FRAMES = 5 * 75;
+constexpr size_t PLAYED_FRAMES = 200000;
+
+namespace {
+    using frame_samples = std::array<audipi::sample_data, SAMPLES_IN_FRAME>;
+
+    /**
+    * @brief The std::map based cache SampleBuffer used to be, kept for comparison.
+    */
+    class MapSampleBuffer {
+        std::map<size_t, frame_samples> cache;
+        std::set<size_t> expired;
+        size_t max_frames;
+        mutable std::mutex mutex;
+
+    public:
+        explicit MapSampleBuffer(const size_t max_frames) : max_frames(max_frames) {
+        }
+
+        void add_frame(const size_t frame, const frame_samples &samples) {
+            std::lock_guard lg(this->mutex);
+
+            if (this->cache.size() == max_frames) {
+                for (auto expired_i: this->expired) {
+                    this->cache.erase(expired_i);
+                }
+                this->expired.clear();
+            }
+
+            this->cache[frame] = samples;
+            this->expired.erase(frame);
+        }
+
+        bool has_frame(const size_t frame) const {
+            std::lock_guard lg(this->mutex);
+
+            return this->cache.contains(frame);
+        }
+
+        bool read_frame(const size_t frame, frame_samples &samples) {
+            std::lock_guard lg(this->mutex);
+
+            this->expired.insert(frame);
+            samples = this->cache[frame];
+            return true;
+        }
+    };
+
+    frame_samples make_frame(const size_t frame) {
+        frame_samples samples{};
+        samples[0] = {static_cast<u_int8_t>(frame), 0, 0, 0};
+        return samples;
+    }
+}
+
+namespace audipi::bench {
+    void sample_buffer() {
+        const frame_samples samples = make_frame(1);
+        frame_samples frame{};
+
+        {
+            MapSampleBuffer buffer(CACHE_FRAMES);
+            run("std::map cache: add_frame (sequential)", PLAYED_FRAMES, [&](const size_t i) {
+                buffer.add_frame(i, samples);
+                buffer.read_frame(i, frame); // mark expired so the map can evict
+            });
+        }
+        {
+            SampleBuffer buffer(CACHE_FRAMES * sizeof(frame_samples), 0, PLAYED_FRAMES + READ_AHEAD_FRAMES);
+            run("disc cache: add_frame (sequential)", PLAYED_FRAMES, [&](const size_t i) {
+                buffer.add_frame(i, samples);
+            });
+        }
+
+        // playback pattern: the reader stays READ_AHEAD_FRAMES ahead of the play cursor
+        {
+            MapSampleBuffer buffer(CACHE_FRAMES);
+            for (size_t i = 0; i < READ_AHEAD_FRAMES; ++i) {
+                buffer.add_frame(i, samples);
+            }
+            run("std::map cache: read-ahead + play", PLAYED_FRAMES, [&](const size_t i) {
+                if (!buffer.has_frame(i + READ_AHEAD_FRAMES)) {
+                    buffer.add_frame(i + READ_AHEAD_FRAMES, samples);
+                }
+                do_not_optimize(buffer.read_frame(i, frame));
+            });
+        }
+        {
+            SampleBuffer buffer(CACHE_FRAMES * sizeof(frame_samples), 0, PLAYED_FRAMES + READ_AHEAD_FRAMES);
+            for (size_t i = 0; i < READ_AHEAD_FRAMES; ++i) {
+                buffer.add_frame(i, samples);
+            }
+            run("disc cache: read-ahead + play", PLAYED_FRAMES, [&](const size_t i) {
+                if (!buffer.has_frame(i + READ_AHEAD_FRAMES)) {
+                    buffer.add_frame(i + READ_AHEAD_FRAMES, samples);
+                }
+                do_not_optimize(buffer.read_frame(i, frame));
+            });
+        }
+
+        // lookups only, on a full cache
+        {
+            MapSampleBuffer buffer(CACHE_FRAMES);
+            for (size_t i = 0; i < CACHE_FRAMES; ++i) {
+                buffer.add_frame(i, samples);
+            }
+            run("std::map cache: has_frame", PLAYED_FRAMES, [&](const size_t i) {
+                do_not_optimize(buffer.has_frame(i % (2 * CACHE_FRAMES)));
+            });
+        }
+        {
+            SampleBuffer buffer(CACHE_FRAMES * sizeof(frame_samples), 0, PLAYED_FRAMES + READ_AHEAD_FRAMES);
+            for (size_t i = 0; i < CACHE_FRAMES; ++i) {
+                buffer.add_frame(i, samples);
+            }
+            run("disc cache: has_frame", PLAYED_FRAMES, [&](const size_t i) {
+                do_not_optimize(buffer.has_frame(i % (2 * CACHE_FRAMES)));
+            });
+        }
+
+        // a full cache, every insertion evicts, stepping around the protected play window and track starts
+        {
+            SampleBuffer buffer(CACHE_FRAMES * sizeof(frame_samples), 0, 10 * PLAYED_FRAMES,
+                                {0, PLAYED_FRAMES, 2 * PLAYED_FRAMES});
+            for (size_t i = 0; i < CACHE_FRAMES; ++i) {
+                buffer.add_frame(i, samples);
+            }
+            run("disc cache: add_frame evicting (protected)", PLAYED_FRAMES, [&](const size_t i) {
+                const size_t frame = CACHE_FRAMES + i;
+                buffer.protect(window_role::current, &buffer, frame, frame + READ_AHEAD_FRAMES, READ_AHEAD_FRAMES);
+                buffer.add_frame(frame, samples);
+            });
+        }
+
+        // unpacking raw drive data into the cache, what CdRom::read_frame()'s copy_from() used to do per frame
+        {
+            SampleBuffer buffer(CACHE_FRAMES * sizeof(frame_samples), 0, PLAYED_FRAMES);
+            std::array<u_int8_t, CD_FRAMESIZE_RAW> raw_data{};
+            run("disc cache: add_frame from raw data", PLAYED_FRAMES, [&](const size_t i) {
+                raw_data[0] = static_cast<u_int8_t>(i);
+                buffer.add_frame(i, raw_data.data());
+            });
+        }
+    }
+}
@@ -0,0 +1,28 @@
+#include <vector>
+
+#include "bench.h"
+#include "../testing/FakeScsiTransport.h"
+
+constexpr size_t BATCH_FRAMES = 25;
+
+namespace audipi::bench {
+    void scsi_read() {
+        auto transport = std::make_unique<testing::FakeScsiTransport>();
+        transport->c2_error_every = 100;
+        ScsiCdRom cd_rom(std::move(transport));
+
+        std::vector<u_int8_t> audio(BATCH_FRAMES * CD_FRAMESIZE_RAW);
+        std::vector<u_int8_t> c2_pointers(BATCH_FRAMES * CD_C2_BYTES);
+        std::vector<subchannel_position> subchannel(BATCH_FRAMES);
+
+        // what the command itself costs is up to the drive, this is the unpacking around it
+        run("ScsiCdRom::read_frames(), 25 frames", 20000, [&](const size_t i) {
+            do_not_optimize(cd_rom.read_frames(frames_to_msf_location(150 + i % 1000 * BATCH_FRAMES), BATCH_FRAMES,
+                                               audio.data()));
+        });
+        run("ScsiCdRom::read_cd() with C2 and Q, 25 frames", 20000, [&](const size_t i) {
+            do_not_optimize(cd_rom.read_cd(frames_to_msf_location(150 + i % 1000 * BATCH_FRAMES), BATCH_FRAMES,
+                                           audio.data(), c2_pointers.data(), subchannel.data()));
+        });
+    }
+}
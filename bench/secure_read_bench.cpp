@@ -0,0 +1,107 @@
+#include <vector>
+
+#include "bench.h"
+#include "../testing/FakeCdRom.h"
+#include "../audipi/SecureReader.h"
+
+// a USB slim drive, per CDROMREADAUDIO command
+constexpr auto DRIVE_LATENCY = std::chrono::milliseconds(2);
+constexpr size_t BATCH_FRAMES = 25;
+constexpr size_t READ_FRAMES = 60 * 75;
+constexpr size_t FIRST_FRAME = 150;
+
+namespace {
+    struct read_outcome {
+        double us_per_frame;
+        size_t wrong_samples;
+        size_t rereads;
+        size_t unverified_frames;
+    };
+
+    size_t count_wrong_samples(const std::vector<u_int8_t> &audio) {
+        size_t wrong = 0;
+        for (size_t i = 0; i < READ_FRAMES * SAMPLES_IN_FRAME; ++i) {
+            u_int32_t sample;
+            std::memcpy(&sample, audio.data() + i * sizeof(sample), sizeof(sample));
+            wrong += sample != FIRST_FRAME * SAMPLES_IN_FRAME + i;
+        }
+        return wrong;
+    }
+
+    read_outcome read_plain(const audipi::CdRom &cd_rom) {
+        std::vector<u_int8_t> audio(READ_FRAMES * CD_FRAMESIZE_RAW);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t frame = 0; frame < READ_FRAMES; frame += BATCH_FRAMES) {
+            if (!cd_rom.read_frames(audipi::frames_to_msf_location(FIRST_FRAME + frame), BATCH_FRAMES,
+                                    audio.data() + frame * CD_FRAMESIZE_RAW)) {
+                break;
+            }
+        }
+        const double elapsed = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count();
+
+        return {elapsed / READ_FRAMES, count_wrong_samples(audio), 0, 0};
+    }
+
+    read_outcome read_secure(const audipi::CdRom &cd_rom) {
+        std::vector<u_int8_t> audio(READ_FRAMES * CD_FRAMESIZE_RAW);
+        audipi::SecureReader reader(cd_rom);
+        read_outcome outcome{0, 0, 0, 0};
+
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t frame = 0; frame < READ_FRAMES; frame += BATCH_FRAMES) {
+            // each batch lines up against the end of the one before, as the cache provides it in the player
+            const u_int8_t *anchor = frame > 0 ? audio.data() + (frame - 1) * CD_FRAMESIZE_RAW : nullptr;
+            const auto result = reader.read(FIRST_FRAME + frame, BATCH_FRAMES, audio.data() + frame * CD_FRAMESIZE_RAW,
+                                            FIRST_FRAME, FIRST_FRAME + READ_FRAMES + 75, anchor);
+            if (!result) {
+                break;
+            }
+            outcome.rereads += result->rereads;
+            outcome.unverified_frames += result->unverified_frames;
+        }
+        const double elapsed = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count();
+
+        outcome.us_per_frame = elapsed / READ_FRAMES;
+        outcome.wrong_samples = count_wrong_samples(audio);
+        return outcome;
+    }
+
+    void print(const char *name, const read_outcome &outcome) {
+        // a frame lasts 1/75 s
+        const double realtime = 1e6 / 75 / outcome.us_per_frame;
+        printf("%-48s %12.1f us/frame %6.1fx realtime %8zu wrong samples %4zu rereads %3zu unverified\n", name,
+               outcome.us_per_frame, realtime, outcome.wrong_samples, outcome.rereads, outcome.unverified_frames);
+    }
+}
+
+namespace audipi::bench {
+    bool secure_read() {
+        std::vector<u_int8_t> a(CD_FRAMESIZE_RAW), b(CD_FRAMESIZE_RAW);
+        for (size_t i = 0; i < a.size(); ++i) {
+            a[i] = b[i] = static_cast<u_int8_t>(i);
+        }
+        run("matching_samples(), one whole frame", 1000000, [&](size_t) {
+            do_not_optimize(matching_samples(a.data(), b.data(), SAMPLES_IN_FRAME));
+        });
+
+        testing::FakeCdRom cd_rom(DRIVE_LATENCY);
+        print("plain reads, clean drive", read_plain(cd_rom));
+        print("secure reads, clean drive", read_secure(cd_rom));
+
+        // one read in five misplaced by up to a third of a frame, one frame in fifty with a flipped bit
+        cd_rom.set_faults({0.2, 200, 0.02});
+        print("plain reads, jitter and bit errors", read_plain(cd_rom));
+        cd_rom.set_faults({0.2, 200, 0.02});
+        const auto secure = read_secure(cd_rom);
+        print("secure reads, jitter and bit errors", secure);
+
+        if (secure.wrong_samples > 0) {
+            printf("FAILED: secure reads got %zu samples wrong\n", secure.wrong_samples);
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "../testing/FakeCdRom.h"
+#include "../audipi/PlayerTrack.h"
+#include "../audipi/TrackReader.h"
+
+constexpr auto DRIVE_LATENCY = std::chrono::milliseconds(2);
+// a full stroke on a slim drive, most seeks only travel part of it
+constexpr auto FULL_STROKE_SEEK = std::chrono::milliseconds(150);
+constexpr size_t SEEKS = 40;
+
+namespace {
+    struct seek_latency {
+        double mean_ms;
+        double max_ms;
+    };
+
+    // time from seek() to audio at the target being ready for the device, as Player::seek() drives it
+    seek_latency measure_seeks(audipi::CdPlayerTrack &track, audipi::TrackReader &reader,
+                               const std::vector<size_t> &targets) {
+        double total = 0;
+        double max = 0;
+
+        for (const size_t target: targets) {
+            const auto start = std::chrono::steady_clock::now();
+
+            reader.set_track(nullptr);
+            if (!track.seek(audipi::msfs_location{0, 0, 0, 0} + target)) {
+                continue;
+            }
+            reader.set_track(&track);
+            while (true) {
+                if (const auto samples = track.peek_samples(); samples && !samples->empty()) {
+                    break;
+                }
+                std::this_thread::yield();
+            }
+
+            const double elapsed = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+            total += elapsed;
+            max = std::max(max, elapsed);
+
+            // let some of the read-ahead happen, as it would while listening
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+
+        return {total / static_cast<double>(targets.size()), max};
+    }
+}
+
+namespace audipi::bench {
+    void seek() {
+        testing::FakeCdRom cd_rom(DRIVE_LATENCY, FULL_STROKE_SEEK);
+        const disk_toc toc{1, 1, {{1, {0, 2, 0}, {20, 0, 0}}}};
+        const size_t track_samples = msf_location_to_frames(toc.entries[0].duration) * SAMPLES_IN_FRAME;
+
+        CdPlayerTrack track(cd_rom, toc.entries[0], SampleBuffer::for_disc(toc, 32 * 1024 * 1024));
+        TrackReader reader(5 * 75);
+
+        std::mt19937 random(42);
+        std::uniform_int_distribution<size_t> sample(0, track_samples - 1);
+        std::vector<size_t> targets(SEEKS);
+        std::ranges::generate(targets, [&] { return sample(random); });
+
+        const auto cold = measure_seeks(track, reader, targets);
+        // the same targets again, now in the cache
+        const auto warm = measure_seeks(track, reader, targets);
+        reader.set_track(nullptr);
+
+        printf("%-48s %12.2f ms mean %10.2f ms max\n", "seek to audio ready, cache miss", cold.mean_ms, cold.max_ms);
+        printf("%-48s %12.2f ms mean %10.2f ms max\n", "seek to audio ready, cache hit", warm.mean_ms, warm.max_ms);
+    }
+}
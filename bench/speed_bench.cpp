@@ -0,0 +1,105 @@
+#include <optional>
+
+#include "bench.h"
+#include "../testing/FakeCdRom.h"
+#include "../audipi/PlayerTrack.h"
+#include "../audipi/SpeedGovernor.h"
+#include "../audipi/TrackReader.h"
+
+// simulated time runs this much faster than real time
+constexpr double TIME_SCALE = 30;
+constexpr unsigned int MAX_SPEED = 24;
+constexpr auto SPIN_UP_PER_SPEED = std::chrono::milliseconds(40);
+constexpr auto SPIN_DOWN_AFTER = std::chrono::seconds(5);
+constexpr size_t PLAY_FRAMES = 60 * 75;
+
+namespace {
+    struct playback_outcome {
+        size_t stalls; // frames playback had to wait for once it started, each a dropout on a real device
+        size_t spin_ups;
+        size_t speed_changes;
+        double mean_speed;
+    };
+
+    std::chrono::microseconds scaled(const std::chrono::microseconds time) {
+        return std::chrono::microseconds(static_cast<long>(static_cast<double>(time.count()) / TIME_SCALE));
+    }
+
+    // plays a minute of audio in (scaled) real time, one frame at a time
+    playback_outcome play(const std::optional<audipi::speed_governor_config> &config) {
+        audipi::testing::SpinningCdRom cd_rom(TIME_SCALE, MAX_SPEED, SPIN_UP_PER_SPEED, SPIN_DOWN_AFTER);
+        const audipi::disk_toc toc{1, 1, {{1, {0, 2, 0}, {2, 0, 0}}}};
+
+        std::optional<audipi::SpeedGovernor> governor;
+        audipi::CdPlayerTrack track(cd_rom, toc.entries[0], audipi::SampleBuffer::for_disc(toc, 32 * 1024 * 1024));
+        if (config) {
+            track.set_speed_governor(&governor.emplace(cd_rom, config.value()));
+        }
+        // as the player does once the track plays
+        track.set_output_buffered(0);
+
+        audipi::TrackReader reader(5 * 75);
+        reader.set_track(&track);
+
+        size_t stalls = 0;
+        const auto frame_time = scaled(std::chrono::microseconds(1000000 / CD_FRAMES));
+        std::chrono::steady_clock::time_point next_frame;
+        for (size_t frame = 0; frame < PLAY_FRAMES; ++frame) {
+            size_t remaining = SAMPLES_IN_FRAME;
+            bool stalled = false;
+            while (remaining > 0) {
+                const auto samples = track.peek_samples();
+                if (!samples || samples->empty()) {
+                    stalled = true;
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                    continue;
+                }
+                const size_t consumed = std::min(samples->size(), remaining);
+                track.consume_samples(consumed);
+                remaining -= consumed;
+            }
+            reader.notify();
+
+            // the clock starts with the first frame, as a sound card's does: waiting for it is spin-up, and
+            // catching up on that wait afterwards would outrun any drive
+            if (frame == 0) {
+                next_frame = std::chrono::steady_clock::now();
+            } else if (stalled) {
+                ++stalls;
+                next_frame = std::max(next_frame, std::chrono::steady_clock::now());
+            }
+            next_frame += frame_time;
+            std::this_thread::sleep_until(next_frame);
+        }
+        reader.set_track(nullptr);
+
+        return {stalls, cd_rom.get_spin_ups(), cd_rom.get_speed_changes(), cd_rom.mean_speed()};
+    }
+
+    void print(const char *name, const playback_outcome &outcome) {
+        printf("%-48s %8.1fx mean speed %4zu speed changes %4zu spin-ups %6zu frames late\n", name, outcome.mean_speed,
+               outcome.speed_changes, outcome.spin_ups, outcome.stalls);
+    }
+}
+
+namespace audipi::bench {
+    bool speed_control() {
+        const auto full_speed = play(std::nullopt);
+        print("a minute of playback, drive at full speed", full_speed);
+
+        speed_governor_config config;
+        config.step_up_after = std::chrono::duration_cast<std::chrono::milliseconds>(
+            scaled(config.step_up_after));
+        config.step_down_after = std::chrono::duration_cast<std::chrono::milliseconds>(
+            scaled(config.step_down_after));
+        const auto governed = play(config);
+        print("a minute of playback, speed governor", governed);
+
+        // slowing the drive down is only worth it if playback keeps up as well as at full speed
+        if (governed.stalls > full_speed.stalls) {
+            printf("FAILED: the speed governor let playback stall more than the drive at full speed\n");
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,62 @@
+#include <memory>
+#include <vector>
+
+#include "bench.h"
+#include "../testing/FakeCdRom.h"
+#include "../audipi/PlayerTrack.h"
+#include "../audipi/TrackReader.h"
+
+// a seek plus a read command on a real drive spinning at audio speed
+constexpr auto DRIVE_LATENCY = std::chrono::milliseconds(5);
+
+namespace {
+    audipi::disk_toc make_toc(const u_int8_t num_tracks) {
+        audipi::disk_toc toc{1, num_tracks, {}};
+        for (u_int8_t i = 0; i < num_tracks; ++i) {
+            const auto address = audipi::frames_to_msf_location(150 + i * 3 * 60 * 75);
+            toc.entries.push_back({static_cast<u_int8_t>(i + 1), address, {3, 0, 0}});
+        }
+        return toc;
+    }
+
+    // time from the TOC being read to the first sample of the first track being ready for the audio device
+    double time_to_first_sample(const audipi::disk_toc &toc, const bool prefetch_on_enqueue) {
+        audipi::testing::FakeCdRom cd_rom(DRIVE_LATENCY);
+        audipi::TrackReader reader(5 * 75);
+        std::vector<std::unique_ptr<audipi::CdPlayerTrack>> tracks;
+        const auto buffer = audipi::SampleBuffer::for_disc(toc, 32 * 1024 * 1024);
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for (const auto &entry: toc.entries) {
+            tracks.push_back(std::make_unique<audipi::CdPlayerTrack>(cd_rom, entry, buffer));
+            if (prefetch_on_enqueue) {
+                tracks.back()->prefetch_samples(5 * 44100);
+            }
+        }
+
+        reader.set_track(tracks[0].get(), {tracks[1].get()});
+        while (true) {
+            if (const auto samples = tracks[0]->peek_samples(); samples && !samples->empty()) {
+                break;
+            }
+            reader.notify();
+            std::this_thread::yield();
+        }
+
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        reader.set_track(nullptr);
+        return std::chrono::duration<double, std::milli>(elapsed).count();
+    }
+}
+
+namespace audipi::bench {
+    void startup_latency() {
+        const auto toc = make_toc(12);
+
+        printf("%-48s %12.1f ms\n", "TOC to first sample, prefetch on enqueue",
+               time_to_first_sample(toc, true));
+        printf("%-48s %12.1f ms\n", "TOC to first sample, background prefetch",
+               time_to_first_sample(toc, false));
+    }
+}
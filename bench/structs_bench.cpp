@@ -0,0 +1,33 @@
+#include "bench.h"
+#include "../audipi/structs.h"
+
+constexpr size_t ITERATIONS = 1000000;
+
+namespace audipi::bench {
+    void structs() {
+        msf_location msf{12, 34, 56};
+        run("msf_location + msf_location", ITERATIONS, [&](const size_t i) {
+            msf = msf + msf_location{0, 0, static_cast<u_int8_t>(i % 75)};
+            do_not_optimize(msf);
+        });
+
+        msfs_location msfs{0, 0, 0, 0};
+        run("msfs_location += samples (one period)", ITERATIONS, [&](size_t) {
+            msfs += 1024;
+            do_not_optimize(msfs);
+        });
+
+        const msfs_location end{70, 0, 0, 0};
+        run("msfs_location - samples", ITERATIONS, [&](const size_t i) {
+            do_not_optimize(end - i);
+        });
+
+        run("msf_location_to_frames", ITERATIONS, [&](const size_t i) {
+            do_not_optimize(msf_location_to_frames(msf_location{static_cast<u_int8_t>(i % 80), 30, 40}));
+        });
+
+        run("frames_to_msf_location", ITERATIONS, [&](const size_t i) {
+            do_not_optimize(frames_to_msf_location(i % (80 * 60 * 75)));
+        });
+    }
+}
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <iomanip>
+#include <cstdlib>
 #include <cstring>
 #include <csignal>
 #include <sstream>
@@ -7,10 +8,12 @@
 #include <chrono>
 #include <algorithm>
 
-#include "audipi/AudioDevice.h"
+#include "audipi/AudioSink.h"
 #include "audipi/CdRom.h"
 #include "audipi/Player.h"
+#include "audipi/ScsiCdRom.h"
 #include "audipi/SampleBuffer.h"
+#include "audipi/Trace.h"
 #include "audipi/util.h"
 
 #include "render/curses/curses_main.h"
@@ -31,8 +34,44 @@ void intHandler([[maybe_unused]] int ignored) {
 void print_frame(const audipi::SampleBuffer &sample_buffer, const audipi::msf_location &current_location,
                  size_t track_num);
 
+void print_status_until_interrupted(audipi::Player &player);
+
+int play_image(const char *path);
+
+int run_front_end(int argc, char *argv[]);
+
+// set AUDIPI_TRACE_FILE to record a timeline of the player internals, viewable in chrome://tracing or Perfetto
+const char *trace_file = getenv("AUDIPI_TRACE_FILE");
+
+// set AUDIPI_OUTPUT to play into something else than the default ALSA device, e.g. "null" or "wav:out.wav",
+// see audipi::make_audio_sink()
+const char *output_spec = getenv("AUDIPI_OUTPUT");
+
+// set AUDIPI_PERSISTENT_CACHE to keep the frames of played discs on disk across runs, in that directory, or in
+// $XDG_CACHE_HOME/audipi if empty; all discs together take up to 2000 MiB
+const char *persistent_cache = getenv("AUDIPI_PERSISTENT_CACHE");
+
+// set AUDIPI_SPEED_CONTROL to slow the drive down while the read-ahead keeps up, see audipi::SpeedGovernor
+const char *speed_control = getenv("AUDIPI_SPEED_CONTROL");
+
 int main(int argc, char *argv[]) {
+    if (trace_file != nullptr) {
+        audipi::trace::set_enabled(true);
+    }
+
+    const int status = run_front_end(argc, argv);
 
+    // whichever front end ran, once the player is gone
+    if (trace_file != nullptr) {
+        audipi::trace::set_enabled(false);
+        if (auto result = audipi::trace::write_chrome_json(trace_file); !result) {
+            std::cout << "cannot write trace to " << trace_file << ": " << render_error(result.error()) << std::endl;
+        }
+    }
+    return status;
+}
+
+int run_front_end(int argc, char *argv[]) {
     if (argc > 1 && strcmp(argv[1], "--ncurses") == 0) {
         return curses_main();
     }
@@ -43,8 +82,19 @@ int main(int argc, char *argv[]) {
 
     signal(SIGINT, intHandler);
     signal(SIGTERM, intHandler);
+    // a pcm: sink whose reader goes away should end in a player error, not kill the process
+    signal(SIGPIPE, SIG_IGN);
 
-    auto cd_rom = audipi::CdRom("/dev/sr0");
+    if (argc > 2 && strcmp(argv[1], "--image") == 0) {
+        return play_image(argv[2]);
+    }
+
+    // --sg-io reads with READ CD commands, which time out instead of hanging on a stuck drive
+    const bool use_sg_io = argc > 1 && strcmp(argv[1], "--sg-io") == 0;
+    const std::unique_ptr<audipi::CdRom> cd_rom_ptr = use_sg_io
+                                                          ? std::make_unique<audipi::ScsiCdRom>("/dev/sr0")
+                                                          : std::make_unique<audipi::CdRom>("/dev/sr0");
+    auto &cd_rom = *cd_rom_ptr;
 
     if (!cd_rom.is_init()) {
         std::cout << "cannot open /dev/cdrom" << std::endl;
@@ -68,13 +118,30 @@ int main(int argc, char *argv[]) {
 
     std::cout << "Setup Player..." << std::endl;
 
-    auto player = audipi::Player();
+    auto sink = audipi::make_audio_sink(output_spec != nullptr ? output_spec : "alsa");
+    if (!sink) {
+        std::cout << "cannot start player: " << sink.error() << std::endl;
+        return -1;
+    }
+
+    auto player = audipi::Player(std::move(sink.value()));
 
     if (!player.is_init()) {
         std::cout << "cannot start player (error in audio_device init)" << std::endl;
         return -1;
     }
 
+    if (persistent_cache != nullptr) {
+        player.set_persistent_cache(persistent_cache[0] != '\0'
+                                        ? persistent_cache
+                                        : audipi::PersistentCache::default_directory(),
+                                    audipi::DEFAULT_PERSISTENT_CACHE_BYTES);
+    }
+
+    if (speed_control != nullptr) {
+        player.set_speed_control(audipi::speed_governor_config{});
+    }
+
     // not required, here for demonstration purposes
     if (auto result = cd_rom.start(); !result) {
         std::cout << "start: unexpected error: " << render_error(result.error()) << std::endl;
@@ -119,21 +186,8 @@ int main(int argc, char *argv[]) {
 
     player.play();
 
-    // ReSharper disable once CppDFALoopConditionNotUpdated
-    while (keepRunning) {
-        player.tick();
-
-        auto player_status = player.get_status();
-
-        std::cout << "\rPlayer status: " << static_cast<int>(player_status.state)
-                << " - Track[" << std::setfill('0') << std::setw(2) << player_status.current_track_index
-                << "]: " << player_status.current_track_name
-                << " - Location: " << msf_location_to_string(player_status.current_location_in_track) << std::flush;
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(100L));
-    }
+    print_status_until_interrupted(player);
 
-    std::cout << std::endl;
     std::cout << "Stopping CD..." << std::endl;
 
     if (auto result = cd_rom.stop(); !result) {
@@ -160,6 +214,48 @@ int main(int argc, char *argv[]) {
     return 0;
 }
 
+void print_status_until_interrupted(audipi::Player &player) {
+    // ReSharper disable once CppDFALoopConditionNotUpdated
+    while (keepRunning) {
+        auto player_status = player.get_status();
+
+        std::cout << "\rPlayer status: " << static_cast<int>(player_status.state)
+                << " - Track[" << std::setfill('0') << std::setw(2) << player_status.current_track_index
+                << "]: " << player_status.current_track_name
+                << " - Location: " << msf_location_to_string(player_status.current_location_in_track) << std::flush;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(100L));
+    }
+
+    std::cout << std::endl;
+}
+
+int play_image(const char *path) {
+    auto sink = audipi::make_audio_sink(output_spec != nullptr ? output_spec : "alsa");
+    if (!sink) {
+        std::cout << "cannot start player: " << sink.error() << std::endl;
+        return -1;
+    }
+
+    auto player = audipi::Player(std::move(sink.value()));
+
+    if (!player.is_init()) {
+        std::cout << "cannot start player (error in audio_device init)" << std::endl;
+        return -1;
+    }
+
+    if (auto result = player.enqueue_image(path); !result) {
+        std::cout << "enqueue_image: " << result.error() << std::endl;
+        return -1;
+    }
+
+    player.play();
+
+    print_status_until_interrupted(player);
+
+    return 0;
+}
+
 void print_frame([[maybe_unused]] const audipi::SampleBuffer &sample_buffer, const audipi::msf_location &current_location,
                  const size_t track_num) {
     std::array<int16_t, SAMPLES_IN_FRAME * 2> packed_data{};
@@ -2,6 +2,7 @@
 #include <cstring>
 #include <sstream>
 #include <ncurses.h>
+#include <optional>
 #include <thread>
 
 #include "../../audipi/CdRom.h"
@@ -72,24 +73,35 @@ int curses_main() {
     player.enqueue_cd(cd_rom, disk_toc.value());
 
     int keep_running = 1;
+    std::optional<audipi::player_snapshot> drawn;
+    std::string current_track_name;
     while (keep_running) {
-        player.tick();
-
-        auto [state, current_track_index, current_track_name, current_location_in_track] = player.get_status();
-
-        const int cur_row = getcury(stdscr);
-
-        addstr("Player status: ");
-        addstr(std::to_string(static_cast<int>(state)).c_str());
-        addstr(" - Track[");
-        addstr(audipi::left_pad_string(std::to_string(current_track_index), 2, '0').c_str());
-        addstr("]: ");
-        addstr(current_track_name.c_str());
-        addstr(" - Location: ");
-        addstr(msf_location_to_string(current_location_in_track).c_str());
-        addstr("   ");
-
-        move(cur_row, 0);
+        // the location moves on between snapshots, interpolated from the device clock
+        auto snapshot = player.get_snapshot();
+        snapshot.current_location_in_track = player.get_position();
+        // nothing to redraw until the player publishes something new, or the location reaches the next frame
+        if (snapshot != drawn) {
+            const auto [state, current_track_index, current_location_in_track] = snapshot;
+            if (!drawn || drawn->current_track_index != current_track_index) {
+                current_track_name = player.get_track_name(current_track_index);
+            }
+            drawn = snapshot;
+
+            const int cur_row = getcury(stdscr);
+
+            addstr("Player status: ");
+            addstr(std::to_string(static_cast<int>(state)).c_str());
+            addstr(" - Track[");
+            addstr(audipi::left_pad_string(std::to_string(current_track_index), 2, '0').c_str());
+            addstr("]: ");
+            addstr(current_track_name.c_str());
+            addstr(" - Location: ");
+            addstr(msf_location_to_string(current_location_in_track).c_str());
+            addstr("   ");
+
+            move(cur_row, 0);
+            refresh();
+        }
 
         if (const int read_char = getch(); read_char != ERR) {
             if (read_char == 'p') {
@@ -110,7 +122,6 @@ int curses_main() {
             }
         }
 
-        refresh();
         std::this_thread::sleep_for(std::chrono::milliseconds(20));
     }
 
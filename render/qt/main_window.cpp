@@ -23,12 +23,18 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui_AudiPi)
 
     connect(main_timer, &QTimer::timeout, this, &MainWindow::tick); // NOLINT(*-unused-return-value)
 
+    // called from the player's threads with the player locked, redraw later on the UI thread
+    player->set_status_listener([this](const audipi::status_event event, const audipi::player_snapshot &snapshot) {
+        QMetaObject::invokeMethod(this, [this, event, snapshot] { status_changed(event, snapshot); },
+                                  Qt::QueuedConnection);
+    });
+
     QTimer::singleShot(UPDATE_INTERVAL_MS, this, &MainWindow::initialize);
 }
 
 MainWindow::~MainWindow() {
+    delete player; // first, so that no more status events are posted
     delete ui;
-    delete player;
     delete cd_rom;
 }
 
@@ -59,14 +65,11 @@ void MainWindow::initialize() const {
 }
 
 void MainWindow::play_pause() const {
+    // the button follows the player through status_changed()
     if (player->get_state() == audipi::PlayerState::PLAYING) {
         player->pause();
-        ui->playPauseButton->setIcon(QIcon::fromTheme(QIcon::ThemeIcon::MediaPlaybackStart));
-        ui->playPauseButton->setText("Play");
     } else {
         player->play();
-        ui->playPauseButton->setIcon(QIcon::fromTheme(QIcon::ThemeIcon::MediaPlaybackPause));
-        ui->playPauseButton->setText("Pause");
     }
 }
 
@@ -99,10 +102,36 @@ void MainWindow::eject() const {
     }
 }
 
-void MainWindow::tick() const {
-    player->tick();
+void MainWindow::tick() {
+    // only the location changes between status events, and only if playing
+    auto snapshot = player->get_snapshot();
+    snapshot.current_location_in_track = player->get_position();
+    if (snapshot != drawn) {
+        redraw(snapshot);
+    }
+}
+
+void MainWindow::status_changed(const audipi::status_event event, const audipi::player_snapshot &snapshot) {
+    if (event == audipi::status_event::STATE_CHANGED) {
+        if (snapshot.state == audipi::PlayerState::PLAYING) {
+            ui->playPauseButton->setIcon(QIcon::fromTheme(QIcon::ThemeIcon::MediaPlaybackPause));
+            ui->playPauseButton->setText("Pause");
+        } else {
+            ui->playPauseButton->setIcon(QIcon::fromTheme(QIcon::ThemeIcon::MediaPlaybackStart));
+            ui->playPauseButton->setText("Play");
+        }
+    }
+
+    // events are queued, the player may have moved on since
+    redraw(player->get_snapshot());
+}
 
-    auto [state, current_track_index, current_track_name, current_location_in_track] = player->get_status();
+void MainWindow::redraw(const audipi::player_snapshot &snapshot) {
+    const auto [state, current_track_index, current_location_in_track] = snapshot;
+    if (!drawn || drawn->current_track_index != current_track_index) {
+        current_track_name = player->get_track_name(current_track_index);
+    }
+    drawn = snapshot;
 
     if (state == audipi::PlayerState::PLAYING || state == audipi::PlayerState::PAUSED) {
         ui->statusLabel->setText(current_track_name.c_str());
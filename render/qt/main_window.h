@@ -3,6 +3,8 @@
 
 #include <QListWidget>
 #include <QMainWindow>
+#include <optional>
+#include <string>
 
 #include "../../audipi/Player.h"
 
@@ -32,13 +34,20 @@ public:
 
     void eject() const;
 
-    void tick() const;
+    void tick();
+
+    void status_changed(audipi::status_event event, const audipi::player_snapshot &snapshot);
 
 private:
     Ui_AudiPi *ui;
     QTimer *main_timer;
     audipi::Player *player;
     audipi::CdRom *cd_rom;
+
+    std::optional<audipi::player_snapshot> drawn; // last snapshot shown, nothing is redrawn until it changes
+    std::string current_track_name;
+
+    void redraw(const audipi::player_snapshot &snapshot);
 };
 
 #endif //MAIN_WINDOW_H
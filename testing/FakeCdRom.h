@@ -0,0 +1,237 @@
+#ifndef FAKECDROM_H
+#define FAKECDROM_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+
+#include "../audipi/CdRom.h"
+
+namespace audipi::testing {
+    /**
+    * @brief Ways a cheap drive gets audio wrong without reporting an error.
+    */
+    struct drive_faults {
+        double jitter_rate = 0; // fraction of reads that land misplaced
+        size_t max_jitter_samples = 0; // how far early or late they land
+        double bit_error_rate = 0; // fraction of frames returned with one bit flipped
+    };
+
+    /**
+    * @brief Reads the drive reports as failed: any read touching [first_frame, end_frame), the next times times.
+    */
+    struct read_failure {
+        size_t first_frame;
+        size_t end_frame;
+        int error;
+        size_t times = SIZE_MAX;
+    };
+
+    /**
+    * @brief In-memory drive: every sample holds its own absolute sample number, and each read
+    * can be slowed down to model the drive's command overhead, plus a seek time proportional to how far the head
+    * has to travel when a read does not continue where the previous one ended.
+    */
+    class FakeCdRom final : public CdRom {
+        static constexpr size_t DISC_FRAMES = 80 * 60 * 75;
+
+        std::chrono::microseconds latency_per_read;
+        std::chrono::microseconds full_stroke_seek;
+        mutable std::atomic<size_t> head_frame{0};
+
+        drive_faults faults;
+        mutable std::mutex random_mutex;
+        mutable std::mt19937 random{1};
+        mutable std::optional<read_failure> failure; // guarded by random_mutex
+        mutable size_t failed_reads = 0;
+
+    public:
+        explicit FakeCdRom(const std::chrono::microseconds latency_per_read = std::chrono::microseconds(0),
+                           const std::chrono::microseconds full_stroke_seek = std::chrono::microseconds(0))
+            : latency_per_read(latency_per_read), full_stroke_seek(full_stroke_seek) {
+        }
+
+        /**
+        * @brief Makes reads from now on go wrong as described by faults, reproducibly for a given seed.
+        */
+        void set_faults(const drive_faults &faults, const unsigned int seed = 1) {
+            std::lock_guard lg(random_mutex);
+            this->faults = faults;
+            this->random.seed(seed);
+        }
+
+        /**
+        * @brief Makes reads from now on fail as described by failure, nullopt to stop.
+        */
+        void set_read_failure(const std::optional<read_failure> &failure) {
+            std::lock_guard lg(random_mutex);
+            this->failure = failure;
+        }
+
+        [[nodiscard]] size_t get_failed_reads() const {
+            std::lock_guard lg(random_mutex);
+            return failed_reads;
+        }
+
+        [[nodiscard]] std::expected<void, int> read_frames(const msf_location &location, const size_t nframes,
+                                                           u_int8_t *buffer) const override {
+            const size_t first_frame = msf_location_to_frames(location);
+            {
+                std::lock_guard lg(random_mutex);
+                if (failure && failure->times > 0 && first_frame < failure->end_frame
+                    && first_frame + nframes > failure->first_frame) {
+                    --failure->times;
+                    ++failed_reads;
+                    return std::unexpected(failure->error);
+                }
+            }
+            const size_t head = head_frame.exchange(first_frame + nframes);
+
+            auto latency = latency_per_read;
+            if (head != first_frame) {
+                const size_t distance = head > first_frame ? head - first_frame : first_frame - head;
+                latency += full_stroke_seek * static_cast<long>(std::min(distance, DISC_FRAMES))
+                        / static_cast<long>(DISC_FRAMES);
+            }
+            if (latency.count() > 0) {
+                std::this_thread::sleep_for(latency);
+            }
+
+            std::lock_guard lg(random_mutex);
+            std::uniform_real_distribution<double> chance(0, 1);
+
+            auto first_sample = static_cast<u_int32_t>(first_frame * SAMPLES_IN_FRAME);
+            if (faults.max_jitter_samples > 0 && chance(random) < faults.jitter_rate) {
+                const auto max_jitter = static_cast<long>(faults.max_jitter_samples);
+                first_sample += static_cast<u_int32_t>(std::uniform_int_distribution<long>(-max_jitter, max_jitter)(
+                    random));
+            }
+            for (u_int32_t i = 0; i < nframes * SAMPLES_IN_FRAME; ++i) {
+                const u_int32_t sample = first_sample + i;
+                std::memcpy(buffer + i * sizeof(sample), &sample, sizeof(sample));
+            }
+
+            for (size_t frame = 0; frame < nframes; ++frame) {
+                if (chance(random) < faults.bit_error_rate) {
+                    const size_t bit = std::uniform_int_distribution<size_t>(0, CD_FRAMESIZE_RAW * 8 - 1)(random);
+                    buffer[frame * CD_FRAMESIZE_RAW + bit / 8] ^= static_cast<u_int8_t>(1 << (bit % 8));
+                }
+            }
+            return {};
+        }
+    };
+
+    /**
+    * @brief Drive whose throughput and spin-up time follow the selected speed, and that spins down when left idle.
+    * Time runs time_scale times faster than on a real drive, so that minutes of playback play out in seconds.
+    */
+    class SpinningCdRom final : public CdRom {
+        const double time_scale;
+        const unsigned int max_speed;
+        const std::chrono::microseconds spin_up_per_speed; // to get from standstill to 1x
+        const std::chrono::microseconds spin_down_after;
+
+        mutable std::mutex mutex;
+        mutable unsigned int speed;
+        mutable bool spinning = false;
+        mutable std::chrono::steady_clock::time_point last_read;
+        mutable std::chrono::steady_clock::time_point accounted_until = std::chrono::steady_clock::now();
+        mutable double speed_seconds = 0; // integral of the speed over time
+        mutable double seconds = 0;
+        mutable size_t spin_ups = 0;
+        mutable size_t speed_changes = 0;
+
+        [[nodiscard]] std::chrono::microseconds scaled(const std::chrono::microseconds time) const {
+            return std::chrono::microseconds(static_cast<long>(static_cast<double>(time.count()) / time_scale));
+        }
+
+        void account(const std::chrono::steady_clock::time_point now) const {
+            const double elapsed = std::chrono::duration<double>(now - accounted_until).count();
+            speed_seconds += elapsed * (spinning ? speed : 0);
+            seconds += elapsed;
+            accounted_until = now;
+        }
+
+    public:
+        SpinningCdRom(const double time_scale, const unsigned int max_speed,
+                      const std::chrono::microseconds spin_up_per_speed, const std::chrono::microseconds spin_down_after)
+            : time_scale(time_scale), max_speed(max_speed), spin_up_per_speed(spin_up_per_speed),
+              spin_down_after(spin_down_after), speed(max_speed) {
+        }
+
+        [[nodiscard]] std::expected<void, int> select_speed(const unsigned int new_speed) const override {
+            std::lock_guard lg(mutex);
+            const unsigned int target = new_speed == 0 ? max_speed : std::min(new_speed, max_speed);
+            if (target == speed) {
+                return {};
+            }
+
+            account(std::chrono::steady_clock::now());
+            if (spinning) {
+                // changing speed costs the time to spin between the two
+                const unsigned int difference = target > speed ? target - speed : speed - target;
+                std::this_thread::sleep_for(scaled(spin_up_per_speed * difference));
+            }
+            speed = target;
+            ++speed_changes;
+            return {};
+        }
+
+        [[nodiscard]] std::expected<void, int> read_frames(const msf_location &location, const size_t nframes,
+                                                           u_int8_t *buffer) const override {
+            std::lock_guard lg(mutex);
+            auto now = std::chrono::steady_clock::now();
+            account(now);
+
+            if (spinning && now - last_read > scaled(spin_down_after)) {
+                spinning = false;
+            }
+            if (!spinning) {
+                std::this_thread::sleep_for(scaled(spin_up_per_speed * speed));
+                spinning = true;
+                ++spin_ups;
+            }
+
+            const auto transfer = std::chrono::microseconds(static_cast<long>(
+                1e6 * static_cast<double>(nframes) / (CD_FRAMES * speed)));
+            std::this_thread::sleep_for(scaled(transfer));
+
+            const auto first_sample = static_cast<u_int32_t>(msf_location_to_frames(location) * SAMPLES_IN_FRAME);
+            for (u_int32_t i = 0; i < nframes * SAMPLES_IN_FRAME; ++i) {
+                const u_int32_t sample = first_sample + i;
+                std::memcpy(buffer + i * sizeof(sample), &sample, sizeof(sample));
+            }
+
+            now = std::chrono::steady_clock::now();
+            account(now);
+            last_read = now;
+            return {};
+        }
+
+        /**
+        * @brief Average speed the disc spun at so far, counting standstill as 0.
+        */
+        [[nodiscard]] double mean_speed() const {
+            std::lock_guard lg(mutex);
+            account(std::chrono::steady_clock::now());
+            return seconds > 0 ? speed_seconds / seconds : 0;
+        }
+
+        [[nodiscard]] size_t get_spin_ups() const {
+            std::lock_guard lg(mutex);
+            return spin_ups;
+        }
+
+        [[nodiscard]] size_t get_speed_changes() const {
+            std::lock_guard lg(mutex);
+            return speed_changes;
+        }
+    };
+}
+
+#endif //FAKECDROM_H
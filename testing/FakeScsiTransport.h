@@ -0,0 +1,107 @@
+#ifndef FAKESCSITRANSPORT_H
+#define FAKESCSITRANSPORT_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include "../audipi/ScsiCdRom.h"
+
+namespace audipi::testing {
+    /**
+    * @brief Drive answering READ CD like FakeCdRom reads: every sample holds its own absolute sample number, with the
+    * Q subchannel matching. Can be made to flag C2 errors, to return damaged frames, to refuse C2 reporting, to
+    * refuse reads past the end of the disc, or to time out.
+    */
+    class FakeScsiTransport final : public ScsiTransport {
+        static u_int8_t to_bcd(const size_t value) {
+            return static_cast<u_int8_t>(value / 10 << 4 | value % 10);
+        }
+
+    public:
+        size_t c2_error_every = 0; // frames with C2 errors flagged, every n-th absolute frame, 0 for none
+        // absolute frames in [damaged_first, damaged_end) come back with samples 100 to 199 corrupted, flagged as such
+        // where C2 errors are asked for, the next damaged_reads times a read touches them
+        size_t damaged_first = 0;
+        size_t damaged_end = 0;
+        std::atomic<size_t> damaged_reads{0};
+        size_t end_lba = SIZE_MAX; // reads past it are refused, as past the lead-out
+        bool supports_c2 = true;
+        bool stuck = false; // every command times out
+        size_t track_start = CD_MSF_OFFSET; // absolute frame, for the relative Q position
+        std::atomic<size_t> commands{0};
+
+        [[nodiscard]] std::expected<scsi_result, int> execute(const scsi_command &command) override {
+            commands.fetch_add(1, std::memory_order_relaxed);
+            if (stuck) {
+                return std::unexpected(ETIMEDOUT);
+            }
+
+            const u_int8_t *cdb = command.cdb.data();
+            const bool with_c2 = (cdb[9] & 0x02) != 0;
+            if (cdb[0] != 0xBE || (with_c2 && !supports_c2)) {
+                return scsi_result{0x02, 0x05, 0x24, 0x00, command.data_in_length}; // invalid field in CDB
+            }
+
+            const size_t lba = static_cast<size_t>(cdb[2]) << 24 | cdb[3] << 16 | cdb[4] << 8 | cdb[5];
+            const size_t nframes = static_cast<size_t>(cdb[6]) << 16 | cdb[7] << 8 | cdb[8];
+            if (lba + nframes > end_lba) {
+                return scsi_result{0x02, 0x05, 0x21, 0x00, command.data_in_length}; // LBA out of range
+            }
+            const size_t frame_bytes = CD_FRAMESIZE_RAW + (with_c2 ? CD_C2_BYTES : 0) + CD_Q_BYTES;
+            if (command.data_in_length < nframes * frame_bytes) {
+                return scsi_result{0x02, 0x05, 0x24, 0x00, command.data_in_length};
+            }
+
+            const size_t first_frame = lba + CD_MSF_OFFSET;
+            bool damaged = false;
+            if (first_frame < damaged_end && first_frame + nframes > damaged_first) {
+                size_t left = damaged_reads.load();
+                while (left > 0 && !damaged_reads.compare_exchange_weak(left, left - 1)) {
+                }
+                damaged = left > 0;
+            }
+
+            for (size_t i = 0; i < nframes; ++i) {
+                const size_t frame = lba + CD_MSF_OFFSET + i;
+                u_int8_t *data = command.data_in + i * frame_bytes;
+
+                const auto first_sample = static_cast<u_int32_t>(frame * SAMPLES_IN_FRAME);
+                for (u_int32_t s = 0; s < SAMPLES_IN_FRAME; ++s) {
+                    const u_int32_t sample = first_sample + s;
+                    std::memcpy(data + s * sizeof(sample), &sample, sizeof(sample));
+                }
+                if (with_c2) {
+                    std::memset(data + CD_FRAMESIZE_RAW, 0, CD_C2_BYTES);
+                    if (c2_error_every != 0 && frame % c2_error_every == 0) {
+                        data[CD_FRAMESIZE_RAW] = 0x80;
+                    }
+                }
+                if (damaged && frame >= damaged_first && frame < damaged_end) {
+                    for (size_t s = 100; s < 200; ++s) {
+                        data[s * 4] ^= 0xFF;
+                        if (with_c2) {
+                            data[CD_FRAMESIZE_RAW + s / 2] |= s % 2 == 0 ? 0xF0 : 0x0F;
+                        }
+                    }
+                }
+
+                u_int8_t *q = data + frame_bytes - CD_Q_BYTES;
+                const size_t relative = frame - std::min(frame, track_start);
+                std::memset(q, 0, CD_Q_BYTES);
+                q[0] = 0x01;
+                q[1] = 0x01;
+                q[2] = 0x01;
+                q[3] = to_bcd(relative / (60 * 75));
+                q[4] = to_bcd(relative / 75 % 60);
+                q[5] = to_bcd(relative % 75);
+                q[7] = to_bcd(frame / (60 * 75));
+                q[8] = to_bcd(frame / 75 % 60);
+                q[9] = to_bcd(frame % 75);
+            }
+            return scsi_result{0x00, 0, 0, 0, command.data_in_length - nframes * frame_bytes};
+        }
+    };
+}
+
+#endif //FAKESCSITRANSPORT_H
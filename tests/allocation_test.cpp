@@ -0,0 +1,71 @@
+#include <thread>
+
+#include "tests.h"
+#include "../audipi/NullSink.h"
+#include "../audipi/Player.h"
+#include "../audipi/PlayerTrack.h"
+#include "../audipi/TrackReader.h"
+#include "../testing/FakeCdRom.h"
+
+// played before counting, so that every lazy allocation has happened
+constexpr size_t WARM_UP_FRAMES = 10 * 75;
+constexpr size_t COUNTED_FRAMES = 60 * 75;
+
+namespace audipi::tests {
+    void peek_consume_allocations() {
+        testing::FakeCdRom cd_rom;
+        const disk_toc_entry toc_entry{1, {0, 2, 0}, {2, 0, 0}};
+        CdPlayerTrack track(cd_rom, toc_entry, SampleBuffer::for_disc({1, 1, {toc_entry}}, 30 * 75 * CD_FRAMESIZE_RAW));
+        TrackReader reader(5 * 75);
+        reader.set_track(&track);
+
+        size_t allocations_before = 0;
+        for (size_t frame = 0; frame < WARM_UP_FRAMES + COUNTED_FRAMES; ++frame) {
+            if (frame == WARM_UP_FRAMES) {
+                allocations_before = allocation_count();
+            }
+            size_t remaining = SAMPLES_IN_FRAME;
+            while (remaining > 0) {
+                const auto samples = track.peek_samples();
+                if (!samples || samples->empty()) {
+                    reader.notify();
+                    std::this_thread::yield();
+                    continue;
+                }
+                const size_t consumed = std::min(samples->size(), remaining);
+                track.consume_samples(consumed);
+                remaining -= consumed;
+            }
+            reader.notify();
+        }
+        const size_t allocations = allocation_count() - allocations_before;
+        reader.set_track(nullptr);
+
+        check(allocations == 0, "peek_samples/consume_samples, with the reader feeding them, never allocate");
+    }
+
+    void player_tick_allocations() {
+        testing::FakeCdRom cd_rom;
+        Player player(std::make_unique<NullSink>());
+        player.set_persistent_cache("", 0);
+        player.enqueue_cd(cd_rom, {1, 1, {{1, {0, 2, 0}, {70, 0, 0}}}});
+        player.play();
+
+        const auto frames_played = [&player] {
+            return msf_location_to_frames(player.get_snapshot().current_location_in_track);
+        };
+        while (frames_played() < WARM_UP_FRAMES) {
+            player.tick();
+        }
+
+        const size_t allocations_before = allocation_count();
+        const size_t start_frame = frames_played();
+        while (frames_played() < start_frame + COUNTED_FRAMES) {
+            player.tick();
+        }
+        const size_t allocations = allocation_count() - allocations_before;
+        player.stop();
+
+        check(allocations == 0, "Player::tick into a NullSink never allocates in steady state");
+    }
+}
@@ -0,0 +1,94 @@
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <vector>
+
+#include "tests.h"
+#include "../audipi/AudioDevice.h"
+
+constexpr size_t PLAYED_SAMPLES = 44100;
+constexpr size_t MAX_ENQUEUES = 100000;
+constexpr int WAIT_TIMEOUT_MS = 100;
+
+namespace {
+    std::vector<audipi::sample_data> numbered_samples() {
+        std::vector<audipi::sample_data> samples(PLAYED_SAMPLES);
+        for (size_t i = 0; i < samples.size(); ++i) {
+            const auto left = static_cast<u_int16_t>(i);
+            const auto right = static_cast<u_int16_t>(~i);
+            samples[i] = {{
+                static_cast<u_int8_t>(left), static_cast<u_int8_t>(left >> 8),
+                static_cast<u_int8_t>(right), static_cast<u_int8_t>(right >> 8)
+            }};
+        }
+        return samples;
+    }
+
+    // enqueues all of samples, waiting for room as the output thread does; returns how many went in
+    size_t play(audipi::AudioDevice &device, const std::vector<audipi::sample_data> &samples) {
+        size_t written = 0;
+        for (size_t enqueue = 0; written < samples.size() && enqueue < MAX_ENQUEUES; ++enqueue) {
+            const auto result = device.enqueue_for_playback(samples.data() + written, samples.size() - written);
+            if (!result) {
+                break;
+            }
+            written += static_cast<size_t>(result.value());
+            if (result.value() == 0 && !device.wait_for_space(WAIT_TIMEOUT_MS)) {
+                break;
+            }
+        }
+        return written;
+    }
+
+    // plays samples into the ALSA file plugin, which hands them to the null device and writes them to path as they
+    // are; returns what landed in the file, or nullopt if ALSA cannot open the device here
+    std::optional<std::vector<u_int8_t>> play_to_file(const std::filesystem::path &path, const bool use_mmap,
+                                                      bool &is_mmap, const std::vector<audipi::sample_data> &samples) {
+        {
+            audipi::AudioDevice device({"file:FILE=" + path.string() + ",FORMAT=raw", audipi::DRIVER_LATENCY_PROFILE,
+                                        use_mmap});
+            if (!device.is_init()) {
+                return std::nullopt;
+            }
+            is_mmap = device.is_mmap();
+            audipi::tests::check(play(device, samples) == samples.size(), "audio device: every sample is taken");
+        }
+
+        std::ifstream file(path, std::ios::binary);
+        std::vector<u_int8_t> written((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::filesystem::remove(path);
+        return written;
+    }
+}
+
+namespace audipi::tests {
+    void audio_device_mmap() {
+        char directory_template[] = "/tmp/audipi_device_test_XXXXXX";
+        if (!check(mkdtemp(directory_template) != nullptr, "a temporary directory can be created")) {
+            return;
+        }
+        const std::filesystem::path directory(directory_template);
+        const auto samples = numbered_samples();
+        const auto *sample_bytes = reinterpret_cast<const u_int8_t *>(samples.data());
+        const std::vector<u_int8_t> expected(sample_bytes, sample_bytes + samples.size() * sizeof(sample_data));
+
+        bool is_mmap = false;
+        const auto mmap_written = play_to_file(directory / "mmap.raw", true, is_mmap, samples);
+        if (!mmap_written) {
+            printf("audio_device_mmap: ALSA cannot open its file plugin here, skipped\n");
+            std::filesystem::remove_all(directory);
+            return;
+        }
+        check(is_mmap, "mmap: the null device takes mmap access when asked for it");
+        check(mmap_written.value() == expected, "mmap: the frames come out of the ring buffer intact");
+
+        // what a device without mmap access falls back to
+        const auto rw_written = play_to_file(directory / "rw.raw", false, is_mmap, samples);
+        check(rw_written && !is_mmap, "read/write: the device writes with snd_pcm_writei unless mmap is asked for");
+        check(rw_written && rw_written.value() == expected, "read/write: the frames come out intact");
+
+        std::filesystem::remove_all(directory);
+    }
+}
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "tests.h"
+#include "../audipi/AudioSink.h"
+
+constexpr size_t WRITTEN_SAMPLES = 10000;
+constexpr size_t ENQUEUE_SAMPLES = 3000;
+constexpr size_t WAV_HEADER_BYTES = 44;
+
+namespace {
+    std::vector<u_int8_t> read_file(const std::filesystem::path &path) {
+        std::ifstream file(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    }
+
+    u_int32_t read_le32(const u_int8_t *data) {
+        return data[0] | data[1] << 8 | data[2] << 16 | static_cast<u_int32_t>(data[3]) << 24;
+    }
+
+    // writes samples through the sink spec describes in a few uneven batches, then closes it
+    bool write_samples(const std::string &spec, const std::vector<audipi::sample_data> &samples) {
+        auto sink = audipi::make_audio_sink(spec);
+        if (!audipi::tests::check(sink.has_value(), "file sinks: the sink opens")) {
+            return false;
+        }
+        for (size_t written = 0; written < samples.size();) {
+            const auto result = sink.value()->enqueue_for_playback(samples.data() + written,
+                                                                   std::min(ENQUEUE_SAMPLES, samples.size() - written));
+            if (!audipi::tests::check(result.has_value() && result.value() > 0, "file sinks: every batch is written")) {
+                return false;
+            }
+            written += static_cast<size_t>(result.value());
+        }
+        return true;
+    }
+}
+
+namespace audipi::tests {
+    void file_sinks() {
+        char directory_template[] = "/tmp/audipi_sink_test_XXXXXX";
+        if (!check(mkdtemp(directory_template) != nullptr, "a temporary directory can be created")) {
+            return;
+        }
+        const std::filesystem::path directory(directory_template);
+
+        std::vector<sample_data> samples(WRITTEN_SAMPLES);
+        for (size_t i = 0; i < samples.size(); ++i) {
+            const auto value = static_cast<u_int32_t>(i * 2654435761u);
+            std::memcpy(samples[i].data, &value, sizeof(value));
+        }
+        const auto *sample_bytes = reinterpret_cast<const u_int8_t *>(samples.data());
+        const std::vector<u_int8_t> payload(sample_bytes, sample_bytes + samples.size() * sizeof(sample_data));
+
+        if (write_samples("pcm:" + (directory / "out.pcm").string(), samples)) {
+            check(read_file(directory / "out.pcm") == payload, "pcm: the file holds the samples as they were given");
+        }
+
+        if (write_samples("wav:" + (directory / "out.wav").string(), samples)) {
+            const auto wav = read_file(directory / "out.wav");
+            if (check(wav.size() == WAV_HEADER_BYTES + payload.size(), "wav: a 44 byte header, then the samples")) {
+                check(std::memcmp(wav.data(), "RIFF", 4) == 0 && std::memcmp(wav.data() + 8, "WAVEfmt ", 8) == 0
+                      && std::memcmp(wav.data() + 36, "data", 4) == 0, "wav: the chunk ids are in place");
+                check(read_le32(wav.data() + 4) == wav.size() - 8, "wav: the RIFF size is finalised on close");
+                check(read_le32(wav.data() + 40) == payload.size(), "wav: the data size is finalised on close");
+                check(std::equal(payload.begin(), payload.end(), wav.begin() + WAV_HEADER_BYTES),
+                      "wav: the samples follow the header as they were given");
+            }
+        }
+
+        for (const auto &spec: {"", "pcm", "pcm:", "wav", "wav:", "null:fast", "flac:out.flac"}) {
+            check(!make_audio_sink(spec).has_value(), "make_audio_sink: a malformed spec is rejected");
+        }
+        check(!make_audio_sink("wav:" + (directory / "missing" / "out.wav").string()).has_value(),
+              "make_audio_sink: a file that cannot be created is reported");
+
+        std::filesystem::remove_all(directory);
+    }
+}
@@ -0,0 +1,157 @@
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+#include "tests.h"
+#include "../audipi/Player.h"
+#include "../testing/FakeCdRom.h"
+
+// back to back on the disc, so that a gapless player hands the sink one run of consecutive absolute samples;
+// the middle track is shorter than a track's playback queue, the last one ends the playlist
+const audipi::disk_toc DISC{
+    1, 3, {
+        {1, {0, 2, 0}, {0, 3, 0}},
+        {2, {0, 5, 0}, {0, 0, 50}},
+        {3, {0, 5, 50}, {0, 3, 0}},
+    }
+};
+constexpr auto PLAY_TIMEOUT = std::chrono::seconds(20);
+constexpr auto SETTLE_TIME = std::chrono::milliseconds(200);
+
+namespace {
+    /**
+    * @brief Takes samples as fast as they come, like a non real time NullSink, checking that each one holds the
+    * absolute sample number following the previous one's.
+    */
+    class ContinuitySink final : public audipi::AudioSink {
+        size_t next_sample;
+        std::atomic<size_t> received{0};
+        std::atomic<size_t> discontinuities{0};
+        std::atomic<size_t> waits{0};
+
+    public:
+        explicit ContinuitySink(const size_t first_sample) : next_sample(first_sample) {
+            this->buffer_size = 4096;
+            this->period_size = 1024;
+            this->avail_min = 1024;
+        }
+
+        [[nodiscard]] bool is_init() const override {
+            return true;
+        }
+
+        [[nodiscard]] std::expected<long, int> enqueue_for_playback(const audipi::sample_data *buffer,
+                                                                    const std::size_t size) override {
+            for (size_t i = 0; i < size; ++i) {
+                u_int32_t value;
+                std::memcpy(&value, buffer[i].data, sizeof(value));
+                if (value != next_sample) {
+                    discontinuities.fetch_add(1, std::memory_order_relaxed);
+                }
+                next_sample = value + 1;
+            }
+            received.fetch_add(size, std::memory_order_relaxed);
+            return static_cast<long>(size);
+        }
+
+        void prepare() override {
+        }
+
+        void pause() override {
+        }
+
+        void resume() override {
+        }
+
+        void reset() override {
+        }
+
+        [[nodiscard]] std::expected<bool, int> wait_for_space(int) override {
+            waits.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::yield();
+            return true;
+        }
+
+        [[nodiscard]] std::expected<unsigned long, long> get_available_samples() override {
+            return buffer_size;
+        }
+
+        [[nodiscard]] std::expected<audipi::device_timestamp, int> get_timestamp() override {
+            return audipi::device_timestamp{0, std::chrono::steady_clock::now(), false};
+        }
+
+        [[nodiscard]] size_t get_received() const {
+            return received.load(std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] size_t get_discontinuities() const {
+            return discontinuities.load(std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] size_t get_waits() const {
+            return waits.load(std::memory_order_relaxed);
+        }
+    };
+
+    struct gapless_run {
+        size_t received;
+        size_t expected;
+        size_t discontinuities;
+        bool stopped; // the player stopped by itself at the end of the playlist
+        size_t waits_after_end; // times the output thread still waited on the sink after the end
+    };
+
+    gapless_run play_disc(audipi::testing::FakeCdRom &cd_rom) {
+        const size_t first_sample = audipi::msf_location_to_frames(DISC.entries.front().address) * SAMPLES_IN_FRAME;
+        size_t total_samples = 0;
+        for (const auto &track: DISC.entries) {
+            total_samples += audipi::msf_location_to_frames(track.duration) * SAMPLES_IN_FRAME;
+        }
+
+        auto sink = std::make_unique<ContinuitySink>(first_sample);
+        const ContinuitySink &continuity = *sink;
+        audipi::Player player(std::move(sink));
+        player.set_persistent_cache("", 0);
+        player.enqueue_cd(cd_rom, DISC);
+        player.play();
+
+        const auto deadline = std::chrono::steady_clock::now() + PLAY_TIMEOUT;
+        while (continuity.get_received() < total_samples && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        while (player.get_state() == audipi::PlayerState::PLAYING && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        // nothing may follow the end of the last track, not even a wakeup of the output thread
+        const size_t waits_at_end = continuity.get_waits();
+        std::this_thread::sleep_for(SETTLE_TIME);
+        const gapless_run run{
+            continuity.get_received(), total_samples, continuity.get_discontinuities(),
+            player.get_state() == audipi::PlayerState::STOPPED, continuity.get_waits() - waits_at_end
+        };
+        player.stop();
+        return run;
+    }
+}
+
+namespace audipi::tests {
+    void gapless_playback() {
+        // a drive faster than playback, where the reader pre-rolls each next track well ahead
+        {
+            testing::FakeCdRom cd_rom;
+            const auto run = play_disc(cd_rom);
+            check(run.received == run.expected, "fast drive: exactly the samples of the three tracks are played");
+            check(run.discontinuities == 0, "fast drive: every sample follows the previous one across the tracks");
+            check(run.stopped && run.waits_after_end == 0, "fast drive: the player stops at the end of the playlist");
+        }
+
+        // a drive so slow that the output thread moves on while the reader is in the middle of a read
+        {
+            testing::FakeCdRom cd_rom(std::chrono::milliseconds(2));
+            const auto run = play_disc(cd_rom);
+            check(run.received == run.expected, "slow drive: exactly the samples of the three tracks are played");
+            check(run.discontinuities == 0, "slow drive: every sample follows the previous one across the tracks");
+            check(run.stopped && run.waits_after_end == 0, "slow drive: the player stops at the end of the playlist");
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#include <cstdlib>
+#include <filesystem>
+#include <linux/cdrom.h>
+#include <sys/stat.h>
+#include <vector>
+
+#include "tests.h"
+#include "../audipi/PersistentCache.h"
+
+constexpr size_t CAP_BYTES = 20 * 1024 * 1024;
+constexpr size_t STORE_BATCH_FRAMES = 25;
+
+// two ten-minute discs, each far bigger than the cap on its own
+const audipi::disk_toc FIRST_DISC{1, 1, {{1, {0, 2, 0}, {10, 0, 0}}}};
+const audipi::disk_toc SECOND_DISC{1, 1, {{1, {0, 2, 0}, {10, 0, 1}}}};
+
+namespace {
+    size_t directory_bytes(const std::filesystem::path &directory) {
+        size_t bytes = 0;
+        for (const auto &entry: std::filesystem::directory_iterator(directory)) {
+            struct stat file_stat{};
+            if (stat(entry.path().c_str(), &file_stat) == 0) {
+                bytes += static_cast<size_t>(file_stat.st_blocks) * 512;
+            }
+        }
+        return bytes;
+    }
+
+    // stores frames of disc from its start, checking the directory against the cap as it goes; returns how many
+    // frames are served back
+    size_t fill(audipi::PersistentCache &cache, const audipi::disk_toc &disc, const std::filesystem::path &directory,
+                const size_t nframes, bool &within_cap) {
+        const size_t first_frame = msf_location_to_frames(disc.entries.front().address);
+        const std::vector<u_int8_t> raw_data(STORE_BATCH_FRAMES * CD_FRAMESIZE_RAW, 0x5A);
+
+        for (size_t frame = 0; frame < nframes; frame += STORE_BATCH_FRAMES) {
+            cache.store_frames(first_frame + frame, STORE_BATCH_FRAMES, raw_data.data());
+            within_cap &= directory_bytes(directory) <= CAP_BYTES;
+        }
+
+        size_t served = 0;
+        while (served < nframes && cache.get_frame(first_frame + served) != nullptr) {
+            ++served;
+        }
+        return served;
+    }
+}
+
+namespace audipi::tests {
+    void persistent_cache_cap() {
+        char directory_template[] = "/tmp/audipi_cache_test_XXXXXX";
+        if (!check(mkdtemp(directory_template) != nullptr, "a temporary cache directory can be created")) {
+            return;
+        }
+        const std::filesystem::path directory(directory_template);
+        const size_t cap_frames = CAP_BYTES / CD_FRAMESIZE_RAW;
+
+        bool within_cap = true;
+        {
+            auto first = PersistentCache::open(directory, FIRST_DISC, CAP_BYTES);
+            check(first.has_value(), "the first disc opens");
+            if (first) {
+                const size_t served = fill(*first.value(), FIRST_DISC, directory, cap_frames, within_cap);
+                check(served > cap_frames * 9 / 10, "the first disc stores up to about the cap");
+            }
+        }
+
+        // played in the same session as the first disc is still on disk: the first one has to go as this one grows
+        {
+            auto second = PersistentCache::open(directory, SECOND_DISC, CAP_BYTES);
+            check(second.has_value(), "the second disc opens");
+            if (second) {
+                const size_t served = fill(*second.value(), SECOND_DISC, directory, 2 * cap_frames, within_cap);
+                check(served > cap_frames * 9 / 10, "the second disc takes over the room of the first");
+            }
+        }
+        check(within_cap, "the cache directory never grows past the cap");
+
+        std::error_code ec;
+        std::filesystem::remove_all(directory, ec);
+    }
+}
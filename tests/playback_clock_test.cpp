@@ -0,0 +1,35 @@
+#include "tests.h"
+#include "../audipi/PlaybackClock.h"
+
+constexpr size_t HEARD_SAMPLES = 10 * audipi::SAMPLE_RATE;
+
+namespace {
+    size_t samples_at(const audipi::PlaybackClock &clock, const std::chrono::steady_clock::time_point now) {
+        return msfs_location_to_samples(clock.location_at(now));
+    }
+}
+
+namespace audipi::tests {
+    void playback_clock() {
+        const auto time = std::chrono::steady_clock::now();
+        PlaybackClock clock;
+
+        clock.set({HEARD_SAMPLES, HEARD_SAMPLES + 2 * SAMPLE_RATE, time, true});
+        check(samples_at(clock, time) == HEARD_SAMPLES, "running: the anchor sample is heard at the anchor time");
+        check(samples_at(clock, time - std::chrono::seconds(1)) == HEARD_SAMPLES,
+              "running: the clock does not run backwards from the anchor");
+        check(samples_at(clock, time + std::chrono::milliseconds(500)) == HEARD_SAMPLES + SAMPLE_RATE / 2,
+              "running: the clock advances with wall time from the anchor");
+        check(samples_at(clock, time + std::chrono::seconds(5)) == HEARD_SAMPLES + 2 * SAMPLE_RATE,
+              "running: the clock stops at the end of what the device was given");
+
+        // an anchor taken while the queue ran dry, behind what is heard
+        clock.set({HEARD_SAMPLES, HEARD_SAMPLES - SAMPLE_RATE, time, true});
+        check(samples_at(clock, time + std::chrono::seconds(1)) == HEARD_SAMPLES,
+              "underrun: the clock holds at the anchor rather than running back to the queue end");
+
+        clock.set({HEARD_SAMPLES, HEARD_SAMPLES + 2 * SAMPLE_RATE, time, false});
+        check(samples_at(clock, time + std::chrono::seconds(1)) == HEARD_SAMPLES,
+              "paused: the clock freezes at the anchor");
+    }
+}
@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "tests.h"
+#include "../audipi/PlayerTrack.h"
+#include "../audipi/TrackReader.h"
+#include "../testing/FakeCdRom.h"
+#include "../testing/FakeScsiTransport.h"
+
+// 20 seconds from 00:02:00, the failing frame well past what the track queues up front
+const audipi::disk_toc_entry TRACK{1, {0, 2, 0}, {0, 20, 0}};
+constexpr size_t FAILING_FRAME = 300; // into the track
+constexpr auto PLAY_TIMEOUT = std::chrono::seconds(20);
+
+namespace {
+    struct playback {
+        size_t frames_played = 0;
+        std::vector<size_t> altered_frames; // frames whose samples are not what the drive holds
+        // largest step, past the one from a sample to the next on the ramp, from the end of an altered frame into the
+        // frame after it: what a concealed frame that fades out would make heard as a click
+        size_t max_jump_after_altered = 0;
+        int error = 0;
+    };
+
+    // plays the whole track as fast as the reader allows, checking every sample against the fake drive's
+    playback play(audipi::CdPlayerTrack &track, audipi::TrackReader &reader) {
+        playback result;
+        const size_t track_frames = msf_location_to_frames(TRACK.duration);
+        const size_t start_sample = msf_location_to_frames(TRACK.address) * SAMPLES_IN_FRAME;
+        const auto deadline = std::chrono::steady_clock::now() + PLAY_TIMEOUT;
+
+        size_t sample = 0;
+        bool frame_altered = false;
+        bool previous_altered = false;
+        u_int32_t previous_value = 0;
+        while (result.frames_played < track_frames && std::chrono::steady_clock::now() < deadline) {
+            const auto samples = track.peek_samples();
+            if (!samples) {
+                result.error = samples.error();
+                break;
+            }
+            if (samples->empty()) {
+                reader.notify();
+                std::this_thread::yield();
+                continue;
+            }
+
+            for (const auto &data: samples.value()) {
+                u_int32_t value;
+                std::memcpy(&value, data.data, sizeof(value));
+                if (previous_altered && sample % SAMPLES_IN_FRAME == 0) {
+                    const long jump = static_cast<long>(value) - static_cast<long>(previous_value) - 1;
+                    result.max_jump_after_altered = std::max(result.max_jump_after_altered,
+                                                             static_cast<size_t>(std::abs(jump)));
+                }
+                previous_value = value;
+                frame_altered |= value != start_sample + sample;
+                ++sample;
+                if (sample % SAMPLES_IN_FRAME == 0) {
+                    if (frame_altered) {
+                        result.altered_frames.push_back(result.frames_played);
+                    }
+                    previous_altered = frame_altered;
+                    frame_altered = false;
+                    ++result.frames_played;
+                }
+            }
+            track.consume_samples(samples->size());
+            reader.notify();
+        }
+        return result;
+    }
+
+    struct read_error_run {
+        playback played;
+        size_t retries;
+        size_t concealed;
+        size_t c2_damaged_reads;
+        size_t failed_reads = 0; // reads the drive failed, or returned damaged
+    };
+
+    read_error_run play_track(audipi::CdRom &cd_rom, const size_t output_buffered,
+                              const audipi::read_mode mode = audipi::read_mode::fast) {
+        audipi::PlayerMetrics metrics;
+        audipi::CdPlayerTrack track(cd_rom, TRACK, audipi::SampleBuffer::for_disc({1, 1, {TRACK}}, 32 * 1024 * 1024));
+        track.set_metrics(&metrics);
+        track.set_read_mode(mode);
+        // as the player reports after each refill: what the device still holds bounds the time left for retries
+        track.set_output_buffered(output_buffered);
+
+        audipi::TrackReader reader(5 * 75);
+        reader.set_track(&track);
+        const auto played = play(track, reader);
+        reader.set_track(nullptr);
+
+        return {
+            played, metrics.read_retries.load(), metrics.concealed_frames.load(), metrics.c2_damaged_reads.load()
+        };
+    }
+
+    read_error_run play_with_failure(const audipi::testing::read_failure &failure, const size_t output_buffered) {
+        audipi::testing::FakeCdRom cd_rom;
+        cd_rom.set_read_failure(failure);
+        auto run = play_track(cd_rom, output_buffered);
+        run.failed_reads = cd_rom.get_failed_reads();
+        return run;
+    }
+
+    // the failing frame comes back with a run of its samples corrupted and flagged by C2 pointers, damaged_reads times
+    read_error_run play_damaged(const size_t damaged_reads, const size_t output_buffered,
+                                const audipi::read_mode mode) {
+        auto transport = std::make_unique<audipi::testing::FakeScsiTransport>();
+        transport->damaged_first = msf_location_to_frames(TRACK.address) + FAILING_FRAME;
+        transport->damaged_end = transport->damaged_first + 1;
+        transport->damaged_reads = damaged_reads;
+        const auto &drive = *transport;
+        audipi::ScsiCdRom cd_rom(std::move(transport));
+        auto run = play_track(cd_rom, output_buffered, mode);
+        run.failed_reads = damaged_reads - drive.damaged_reads.load();
+        return run;
+    }
+}
+
+namespace audipi::tests {
+    void read_error_handling() {
+        const size_t failing = msf_location_to_frames(TRACK.address) + FAILING_FRAME;
+        const size_t track_frames = msf_location_to_frames(TRACK.duration);
+
+        // a frame that fails twice, with plenty of audio buffered: retried until it reads, nothing concealed
+        {
+            const auto run = play_with_failure({failing, failing + 1, EIO, 2}, 5 * SAMPLES_IN_FRAME * CD_FRAMES);
+            check(run.played.error == 0 && run.played.frames_played == track_frames,
+                  "retry: the track plays to its end");
+            check(run.played.altered_frames.empty(), "retry: every sample is the drive's");
+            // whether it failed while read ahead or while playback waited for it
+            check(run.failed_reads == 2, "retry: the failed frame is read again");
+            check(run.concealed == 0, "retry: nothing is concealed when a retry succeeds in time");
+        }
+
+        // a frame that never reads, with nothing buffered: concealed, and playback carries on past it
+        {
+            const auto run = play_with_failure({failing, failing + 1, EIO}, 0);
+            check(run.played.error == 0 && run.played.frames_played == track_frames,
+                  "conceal: the track plays to its end");
+            check(run.concealed == 1, "conceal: exactly the failing frame is concealed");
+            // the fake drive's samples are a ramp, which bridging to the frame after the gap restores exactly
+            check(run.played.altered_frames.empty(), "conceal: the frame is bridged into the one after it");
+        }
+
+        // a frame that never reads, with half a second buffered: retried at a bounded pace until the time is up
+        {
+            const auto run = play_with_failure({failing, failing + 1, EIO}, SAMPLES_IN_FRAME * CD_FRAMES / 2);
+            check(run.played.error == 0 && run.concealed == 1, "paced retry: the frame is concealed in the end");
+            // at most one retry every 10 ms over the time the queue and the device hold, well under two seconds
+            check(run.retries > 1 && run.retries < 200, "paced retry: the retries are spaced out");
+        }
+
+        // two frames in a row that never read: the first one repeats the frame before it, the second one is bridged
+        // from there into the frame after the gap
+        {
+            const auto run = play_with_failure({failing, failing + 2, EIO}, 0);
+            check(run.played.error == 0 && run.played.frames_played == track_frames,
+                  "conceal two: the track plays to its end");
+            check(run.concealed == 2, "conceal two: both failing frames are concealed");
+            check(run.played.altered_frames == std::vector{FAILING_FRAME, FAILING_FRAME + 1},
+                  "conceal two: only the failing frames differ from the drive's samples");
+            check(run.played.max_jump_after_altered <= 2, "conceal two: the gap ends without a jump");
+        }
+
+        // the disc is pulled: playback stops with the error instead of concealing
+        {
+            const auto run = play_with_failure({failing, SIZE_MAX, ENOMEDIUM}, 5 * SAMPLES_IN_FRAME * CD_FRAMES);
+            check(run.played.error == ENOMEDIUM, "fatal: the track reports ENOMEDIUM");
+            check(run.played.frames_played <= FAILING_FRAME, "fatal: nothing plays past the failing frame");
+            check(run.concealed == 0 && run.retries == 0, "fatal: a pulled disc is neither retried nor concealed");
+        }
+    }
+
+    void c2_error_handling() {
+        const size_t buffered = 5 * SAMPLES_IN_FRAME * CD_FRAMES;
+
+        // damaged twice, with plenty of audio buffered: read again until it comes back clean
+        {
+            const auto run = play_damaged(2, buffered, read_mode::fast);
+            check(run.played.error == 0 && run.played.altered_frames.empty(),
+                  "C2 retry: the track plays to its end with every sample the drive's");
+            check(run.c2_damaged_reads > 0 && run.failed_reads == 2, "C2 retry: the damaged frame is read again");
+            check(run.concealed == 0, "C2 retry: nothing is concealed when a clean read comes in time");
+        }
+
+        // damaged on every read, with nothing buffered: the flagged samples are concealed, never played as read
+        {
+            const auto run = play_damaged(SIZE_MAX, 0, read_mode::fast);
+            check(run.played.error == 0 && run.played.frames_played == msf_location_to_frames(TRACK.duration),
+                  "C2 conceal: the track plays to its end");
+            check(run.concealed == 1, "C2 conceal: exactly the damaged frame is concealed");
+            // the fake drive's samples are a ramp, which bridging the flagged run restores exactly
+            check(run.played.altered_frames.empty(), "C2 conceal: none of the corrupted samples is played");
+        }
+
+        // secure reads do not take two identical damaged reads for a verified frame
+        {
+            const auto run = play_damaged(SIZE_MAX, 0, read_mode::secure);
+            check(run.played.error == 0 && run.concealed == 1,
+                  "C2 secure: the damaged frame is concealed rather than verified");
+            check(run.played.altered_frames.empty(), "C2 secure: none of the corrupted samples is played");
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#include <linux/cdrom.h>
+
+#include "tests.h"
+#include "../audipi/SampleBuffer.h"
+
+constexpr size_t CACHE_FRAMES = 100;
+constexpr size_t WINDOW_FRAMES = 20;
+// two tracks, the second one pre-rolled while the first one plays its end
+constexpr size_t SECOND_TRACK = 1000;
+
+namespace {
+    size_t cached(audipi::SampleBuffer &buffer, const size_t first_frame, const size_t end_frame) {
+        size_t frames = 0;
+        for (size_t frame = first_frame; frame < end_frame; ++frame) {
+            frames += buffer.has_frame(frame) ? 1 : 0;
+        }
+        return frames;
+    }
+}
+
+namespace audipi::tests {
+    void sample_buffer_protection() {
+        SampleBuffer buffer(CACHE_FRAMES * CD_FRAMESIZE_RAW, 0, 10 * SECOND_TRACK, {0, SECOND_TRACK});
+        const std::array<sample_data, SAMPLES_IN_FRAME> samples{};
+        const int current = 0, following = 0;
+
+        const size_t current_first = SECOND_TRACK - WINDOW_FRAMES;
+        for (size_t frame = 0; frame < WINDOW_FRAMES; ++frame) {
+            buffer.add_frame(current_first + frame, samples);
+            buffer.add_frame(SECOND_TRACK + frame, samples);
+        }
+        buffer.protect(window_role::current, &current, current_first, SECOND_TRACK, 0);
+        buffer.protect(window_role::following, &following, SECOND_TRACK, SECOND_TRACK + WINDOW_FRAMES, 0);
+
+        // a seek elsewhere on the disc fills the whole cache several times over
+        for (size_t frame = 5 * SECOND_TRACK; frame < 5 * SECOND_TRACK + 5 * CACHE_FRAMES; ++frame) {
+            buffer.add_frame(frame, samples);
+        }
+        check(cached(buffer, current_first, SECOND_TRACK) == WINDOW_FRAMES,
+              "the window of the playing track survives the pre-roll of the next one");
+        check(cached(buffer, SECOND_TRACK, SECOND_TRACK + WINDOW_FRAMES) == WINDOW_FRAMES,
+              "the pre-roll window of the following track survives too");
+
+        // the following track starts playing and the finished one lets go: only the new current window is kept
+        buffer.protect(window_role::current, &following, SECOND_TRACK, SECOND_TRACK + WINDOW_FRAMES, 0);
+        buffer.release(&current);
+        for (size_t frame = 6 * SECOND_TRACK; frame < 6 * SECOND_TRACK + 5 * CACHE_FRAMES; ++frame) {
+            buffer.add_frame(frame, samples);
+        }
+        check(cached(buffer, current_first, SECOND_TRACK) == 0, "a released window is evicted like any other frame");
+        check(cached(buffer, SECOND_TRACK, SECOND_TRACK + WINDOW_FRAMES) == WINDOW_FRAMES,
+              "the window moved to the current role is still protected");
+    }
+}
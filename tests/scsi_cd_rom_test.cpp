@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <cerrno>
+#include <vector>
+
+#include "tests.h"
+#include "../testing/FakeScsiTransport.h"
+
+constexpr size_t FIRST_FRAME = 1000;
+constexpr size_t BATCH_FRAMES = 10;
+
+namespace {
+    struct c2_read {
+        int error; // 0 if the read went through
+        size_t c2_frames;
+        bool any_c2_pointer; // set anywhere in the pointers handed back
+    };
+
+    c2_read read_with_c2(const audipi::ScsiCdRom &cd_rom, const size_t first_frame) {
+        std::vector<u_int8_t> audio(BATCH_FRAMES * CD_FRAMESIZE_RAW);
+        std::vector<u_int8_t> c2_pointers(BATCH_FRAMES * audipi::CD_C2_BYTES);
+        const auto result = cd_rom.read_cd(audipi::frames_to_msf_location(first_frame), BATCH_FRAMES, audio.data(),
+                                           c2_pointers.data());
+        if (!result) {
+            return {result.error(), 0, false};
+        }
+        return {0, result.value(), std::ranges::any_of(c2_pointers, [](const u_int8_t bits) { return bits != 0; })};
+    }
+}
+
+namespace audipi::tests {
+    void scsi_c2_fallback() {
+        // a drive refusing the C2 field on the first read: read without C2 from then on
+        {
+            auto transport = std::make_unique<testing::FakeScsiTransport>();
+            transport->supports_c2 = false;
+            auto &drive = *transport;
+            const ScsiCdRom cd_rom(std::move(transport));
+
+            const auto first = read_with_c2(cd_rom, FIRST_FRAME);
+            check(first.error == 0 && !first.any_c2_pointer, "no C2: the first read falls back to plain audio");
+            const size_t commands = drive.commands;
+            const auto second = read_with_c2(cd_rom, FIRST_FRAME + BATCH_FRAMES);
+            check(second.error == 0 && drive.commands == commands + 1, "no C2: later reads do not ask for C2 again");
+        }
+
+        // any other illegal request on the first read is that read's error, C2 reporting stays on
+        {
+            auto transport = std::make_unique<testing::FakeScsiTransport>();
+            transport->c2_error_every = 5;
+            transport->end_lba = FIRST_FRAME + BATCH_FRAMES - CD_MSF_OFFSET;
+            const ScsiCdRom cd_rom(std::move(transport));
+
+            const auto past_end = read_with_c2(cd_rom, FIRST_FRAME + BATCH_FRAMES);
+            check(past_end.error == EINVAL, "out of range: the read fails with EINVAL");
+            const auto in_range = read_with_c2(cd_rom, FIRST_FRAME);
+            check(in_range.error == 0 && in_range.c2_frames == 2 && in_range.any_c2_pointer,
+                  "out of range: later reads still report C2 errors");
+        }
+
+        // once a read with C2 went through, the drive refusing the field is an error, not a reason to stop asking
+        {
+            auto transport = std::make_unique<testing::FakeScsiTransport>();
+            auto &drive = *transport;
+            const ScsiCdRom cd_rom(std::move(transport));
+
+            check(read_with_c2(cd_rom, FIRST_FRAME).error == 0, "C2 confirmed: the first read goes through");
+            drive.supports_c2 = false;
+            check(read_with_c2(cd_rom, FIRST_FRAME).error == EOPNOTSUPP,
+                  "C2 confirmed: a later refusal is the read's error");
+        }
+    }
+}
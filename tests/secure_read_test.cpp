@@ -0,0 +1,80 @@
+#include <cstring>
+#include <vector>
+
+#include "tests.h"
+#include "../testing/FakeCdRom.h"
+#include "../audipi/SecureReader.h"
+
+constexpr size_t BATCH_FRAMES = 25;
+constexpr size_t READ_FRAMES = 20 * 75;
+constexpr size_t FIRST_FRAME = 150;
+constexpr size_t MAX_COMPARED_SAMPLES = 70;
+
+namespace {
+    size_t count_wrong_samples(const std::vector<u_int8_t> &audio) {
+        size_t wrong = 0;
+        for (size_t i = 0; i < READ_FRAMES * SAMPLES_IN_FRAME; ++i) {
+            u_int32_t sample;
+            std::memcpy(&sample, audio.data() + i * sizeof(sample), sizeof(sample));
+            wrong += sample != FIRST_FRAME * SAMPLES_IN_FRAME + i;
+        }
+        return wrong;
+    }
+
+    // one sample at a time, what the SSE2 and NEON paths have to agree with
+    size_t matching_samples_scalar(const u_int8_t *a, const u_int8_t *b, const size_t nsamples) {
+        size_t i = 0;
+        while (i < nsamples && std::memcmp(a + i * sizeof(audipi::sample_data), b + i * sizeof(audipi::sample_data),
+                                           sizeof(audipi::sample_data)) == 0) {
+            ++i;
+        }
+        return i;
+    }
+}
+
+namespace audipi::tests {
+    void secure_read() {
+        // every length, pointers off alignment, and a difference in each sample (or none) in turn; the samples past
+        // the length are equal, so that comparing them too would show
+        std::vector<u_int8_t> a(MAX_COMPARED_SAMPLES * sizeof(sample_data) + 16);
+        std::vector<u_int8_t> b(a.size());
+        for (size_t i = 0; i < a.size(); ++i) {
+            a[i] = static_cast<u_int8_t>(i * 7);
+        }
+        bool agree = true;
+        for (size_t offset = 0; offset < 4; ++offset) {
+            const u_int8_t *a_samples = a.data() + offset;
+            u_int8_t *b_samples = b.data() + 3 - offset;
+            for (size_t nsamples = 0; nsamples <= MAX_COMPARED_SAMPLES; ++nsamples) {
+                for (size_t differing = 0; differing <= nsamples; ++differing) {
+                    std::memcpy(b_samples, a_samples, a.size() - 4);
+                    if (differing < nsamples) {
+                        b_samples[differing * sizeof(sample_data) + differing % sizeof(sample_data)] ^= 0x10;
+                    }
+                    agree &= matching_samples(a_samples, b_samples, nsamples)
+                            == matching_samples_scalar(a_samples, b_samples, nsamples);
+                }
+            }
+        }
+        check(agree, "matching_samples: the vector paths agree with a sample by sample comparison");
+
+        // one read in five misplaced by up to a third of a frame, one frame in fifty with a flipped bit
+        testing::FakeCdRom cd_rom;
+        cd_rom.set_faults({0.2, 200, 0.02});
+        SecureReader reader(cd_rom);
+        std::vector<u_int8_t> audio(READ_FRAMES * CD_FRAMESIZE_RAW);
+        size_t rereads = 0;
+        for (size_t frame = 0; frame < READ_FRAMES; frame += BATCH_FRAMES) {
+            // each batch lines up against the end of the one before, as the cache provides it in the player
+            const u_int8_t *anchor = frame > 0 ? audio.data() + (frame - 1) * CD_FRAMESIZE_RAW : nullptr;
+            const auto result = reader.read(FIRST_FRAME + frame, BATCH_FRAMES, audio.data() + frame * CD_FRAMESIZE_RAW,
+                                            FIRST_FRAME, FIRST_FRAME + READ_FRAMES + 75, anchor);
+            if (!check(result.has_value(), "secure read: every batch reads")) {
+                return;
+            }
+            rereads += result->rereads;
+        }
+        check(rereads > 0, "secure read: the faulty drive made the reader read again");
+        check(count_wrong_samples(audio) == 0, "secure read: no sample comes out wrong despite jitter and bit errors");
+    }
+}
@@ -0,0 +1,144 @@
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+#include "tests.h"
+#include "../audipi/NullSink.h"
+#include "../audipi/Player.h"
+#include "../testing/FakeCdRom.h"
+
+// one ten-minute track, far longer than the read-ahead
+const audipi::disk_toc DISC{1, 1, {{1, {0, 2, 0}, {10, 0, 0}}}};
+constexpr auto WAIT_TIMEOUT = std::chrono::seconds(5);
+constexpr auto READ_AHEAD_TIME = std::chrono::milliseconds(200);
+
+namespace {
+    /**
+    * @brief Plays out in real time like a NullSink, remembering the first sample written after each reset, i.e. the
+    * first one played after a seek.
+    */
+    class SeekSink final : public audipi::AudioSink {
+        audipi::NullSink sink{true};
+        std::atomic<bool> awaiting_first{false};
+        std::atomic<long> first_after_reset{-1};
+        std::atomic<size_t> received{0};
+
+    public:
+        SeekSink() {
+            this->buffer_size = audipi::NULL_SINK_BUFFER_SAMPLES;
+            this->period_size = audipi::NULL_SINK_PERIOD_SAMPLES;
+            this->avail_min = audipi::NULL_SINK_PERIOD_SAMPLES;
+        }
+
+        [[nodiscard]] bool is_init() const override {
+            return true;
+        }
+
+        [[nodiscard]] std::expected<long, int> enqueue_for_playback(const audipi::sample_data *buffer,
+                                                                    const std::size_t size) override {
+            const auto taken = sink.enqueue_for_playback(buffer, size);
+            if (taken && taken.value() > 0) {
+                if (awaiting_first.exchange(false)) {
+                    u_int32_t value;
+                    std::memcpy(&value, buffer[0].data, sizeof(value));
+                    first_after_reset.store(value);
+                }
+                received.fetch_add(static_cast<size_t>(taken.value()), std::memory_order_relaxed);
+            }
+            return taken;
+        }
+
+        void prepare() override {
+            sink.prepare();
+        }
+
+        void pause() override {
+            sink.pause();
+        }
+
+        void resume() override {
+            sink.resume();
+        }
+
+        void reset() override {
+            sink.reset();
+            first_after_reset.store(-1);
+            awaiting_first.store(true);
+        }
+
+        [[nodiscard]] std::expected<bool, int> wait_for_space(const int timeout_ms) override {
+            return sink.wait_for_space(timeout_ms);
+        }
+
+        [[nodiscard]] std::expected<unsigned long, long> get_available_samples() override {
+            return sink.get_available_samples();
+        }
+
+        [[nodiscard]] std::expected<audipi::device_timestamp, int> get_timestamp() override {
+            return sink.get_timestamp();
+        }
+
+        [[nodiscard]] size_t get_received() const {
+            return received.load(std::memory_order_relaxed);
+        }
+
+        // the first sample written since the last reset, -1 if none came in time
+        [[nodiscard]] long wait_for_first() const {
+            const auto deadline = std::chrono::steady_clock::now() + WAIT_TIMEOUT;
+            while (first_after_reset.load() < 0 && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return first_after_reset.load();
+        }
+    };
+
+    audipi::msfs_location in_track(const size_t samples) {
+        return audipi::msfs_location{0, 0, 0, 0} + samples;
+    }
+}
+
+namespace audipi::tests {
+    void seek_accuracy() {
+        const auto first_sample = static_cast<long>(msf_location_to_frames(DISC.entries.front().address)
+                                                    * SAMPLES_IN_FRAME);
+        testing::FakeCdRom cd_rom;
+        auto owned_sink = std::make_unique<SeekSink>();
+        const SeekSink &sink = *owned_sink;
+        Player player(std::move(owned_sink));
+        player.set_persistent_cache("", 0);
+        player.enqueue_cd(cd_rom, DISC);
+        player.play();
+
+        const auto deadline = std::chrono::steady_clock::now() + WAIT_TIMEOUT;
+        while (sink.get_received() < SAMPLE_RATE && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        // back into what was played already, which the cache still holds
+        constexpr size_t CACHED_TARGET = 20000 + 7;
+        check(player.seek(in_track(CACHED_TARGET)).has_value(), "cached seek: the seek succeeds");
+        check(sink.wait_for_first() == first_sample + static_cast<long>(CACHED_TARGET),
+              "cached seek: the first sample played is the one sought");
+
+        // minutes past the read-ahead, read from the drive by the seek itself
+        constexpr size_t COLD_TARGET = 8 * 60 * SAMPLE_RATE + 123;
+        check(player.seek(in_track(COLD_TARGET)).has_value(), "cold seek: the seek succeeds");
+        check(sink.wait_for_first() == first_sample + static_cast<long>(COLD_TARGET),
+              "cold seek: the first sample played is the one sought");
+
+        // while paused, the device holds nothing after a seek: the sample heard is the one sought, exactly
+        constexpr size_t PAUSED_TARGET = 2 * 60 * SAMPLE_RATE + 5000;
+        constexpr long FORWARD = SAMPLE_RATE / 2 + 17;
+        constexpr long BACKWARD = -301;
+        player.pause();
+        check(player.seek(in_track(PAUSED_TARGET)).has_value(), "relative seek: the seek while paused succeeds");
+        std::this_thread::sleep_for(READ_AHEAD_TIME);
+        check(player.seek_relative(FORWARD).has_value() && player.seek_relative(BACKWARD).has_value(),
+              "relative seek: the seeks succeed");
+        player.play();
+        check(sink.wait_for_first() == first_sample + static_cast<long>(PAUSED_TARGET) + FORWARD + BACKWARD,
+              "relative seek: the first sample played is offset from the one heard, to the sample");
+
+        player.stop();
+    }
+}
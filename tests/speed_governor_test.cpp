@@ -0,0 +1,99 @@
+#include <cerrno>
+#include <thread>
+#include <vector>
+
+#include "tests.h"
+#include "../audipi/SpeedGovernor.h"
+
+constexpr auto HOLD_TIME = std::chrono::milliseconds(50);
+constexpr size_t TARGET_FRAMES = 100;
+
+namespace {
+    /**
+    * @brief Drive that records the speeds selected on it, and refuses them with error while error is set.
+    */
+    class SpeedSelectingCdRom final : public audipi::CdRom {
+        mutable std::vector<unsigned int> selected;
+        int error = 0;
+
+    public:
+        [[nodiscard]] std::expected<void, int> select_speed(const unsigned int speed) const override {
+            selected.push_back(speed);
+            if (error != 0) {
+                return std::unexpected(error);
+            }
+            return {};
+        }
+
+        void set_error(const int new_error) {
+            error = new_error;
+        }
+
+        [[nodiscard]] const std::vector<unsigned int> &get_selected() const {
+            return selected;
+        }
+    };
+
+    audipi::speed_governor_config short_config() {
+        audipi::speed_governor_config config;
+        config.step_up_after = std::chrono::milliseconds(0);
+        config.step_down_after = HOLD_TIME;
+        return config;
+    }
+
+    // keeps the read-ahead full for the whole hold
+    void hold_full(audipi::SpeedGovernor &governor) {
+        governor.update(TARGET_FRAMES, TARGET_FRAMES, false);
+        std::this_thread::sleep_for(2 * HOLD_TIME);
+        governor.update(TARGET_FRAMES, TARGET_FRAMES, false);
+    }
+}
+
+namespace audipi::tests {
+    void speed_governor() {
+        SpeedSelectingCdRom cd_rom;
+        {
+            SpeedGovernor governor(cd_rom, short_config());
+
+            governor.update(TARGET_FRAMES, TARGET_FRAMES, false);
+            governor.update(TARGET_FRAMES, TARGET_FRAMES, false);
+            check(cd_rom.get_selected().empty(), "step down: not before the read-ahead stayed full for the hold");
+
+            std::this_thread::sleep_for(2 * HOLD_TIME);
+            governor.update(TARGET_FRAMES, TARGET_FRAMES, false);
+            check(cd_rom.get_selected() == std::vector<unsigned int>{8} && governor.get_speed() == 8,
+                  "step down: one notch once the read-ahead stayed full for the hold");
+
+            hold_full(governor);
+            check(governor.get_speed() == 4, "step down: another notch after another hold");
+
+            governor.update(0, TARGET_FRAMES, true);
+            check(cd_rom.get_selected().back() == 0 && governor.get_speed() == 0,
+                  "burst: straight to the fastest speed when playback is about to run dry");
+
+            // a transient error leaves the speed alone, and the governor tries again at the next update
+            cd_rom.set_error(EBUSY);
+            hold_full(governor);
+            check(governor.get_speed() == 0, "transient error: the speed stays as it was");
+            cd_rom.set_error(0);
+            const size_t attempts = cd_rom.get_selected().size();
+            governor.update(TARGET_FRAMES, TARGET_FRAMES, false);
+            check(cd_rom.get_selected().size() == attempts + 1 && governor.get_speed() == 8,
+                  "transient error: the governor stays on and steps down at the next update");
+        }
+
+        for (const int error: {ENOSYS, EINVAL, ENOTTY}) {
+            SpeedSelectingCdRom unsupported;
+            unsupported.set_error(error);
+            SpeedGovernor governor(unsupported, short_config());
+            hold_full(governor);
+            check(unsupported.get_selected().size() == 1, "unsupported: the governor tries once");
+
+            unsupported.set_error(0);
+            hold_full(governor);
+            governor.update(0, TARGET_FRAMES, true);
+            check(unsupported.get_selected().size() == 1 && governor.get_speed() == 0,
+                  "unsupported: the governor gives up for good on ENOSYS, EINVAL and ENOTTY");
+        }
+    }
+}
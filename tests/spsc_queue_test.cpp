@@ -0,0 +1,62 @@
+#include <thread>
+
+#include "tests.h"
+#include "../audipi/SpscQueue.h"
+
+constexpr size_t QUEUE_CAPACITY = 16;
+constexpr size_t ITEMS = 2000000;
+
+namespace {
+    struct item {
+        size_t sequence;
+        size_t check; // derived from sequence, so that a torn slot shows
+    };
+}
+
+namespace audipi::tests {
+    void spsc_queue() {
+        SpscQueue<item> queue(QUEUE_CAPACITY);
+
+        std::thread producer([&queue] {
+            for (size_t i = 0; i < ITEMS;) {
+                item *slot = queue.producer_slot();
+                if (slot == nullptr) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                *slot = {i, ~i};
+                queue.push();
+                ++i;
+            }
+        });
+
+        size_t expected = 0;
+        size_t out_of_order = 0;
+        size_t torn = 0;
+        size_t oversized = 0;
+        while (expected < ITEMS) {
+            if (queue.size() > QUEUE_CAPACITY) {
+                ++oversized;
+            }
+            const item *slot = queue.front();
+            if (slot == nullptr) {
+                std::this_thread::yield();
+                continue;
+            }
+            if (slot->sequence != expected) {
+                ++out_of_order;
+            }
+            if (slot->check != ~slot->sequence) {
+                ++torn;
+            }
+            queue.pop();
+            ++expected;
+        }
+        producer.join();
+
+        check(out_of_order == 0, "items arrive in the order they were pushed, none lost or duplicated");
+        check(torn == 0, "a slot is only read once fully written");
+        check(oversized == 0, "size() never exceeds the capacity");
+        check(queue.front() == nullptr && queue.size() == 0, "the queue is empty once everything was consumed");
+    }
+}
@@ -0,0 +1,84 @@
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "tests.h"
+
+namespace {
+    std::atomic<size_t> allocations{0};
+    std::atomic<size_t> failures{0};
+
+    struct test_case {
+        const char *name;
+        void (*run)();
+    };
+
+    constexpr test_case TEST_CASES[] = {
+        {"spsc_queue", audipi::tests::spsc_queue},
+        {"sample_buffer_protection", audipi::tests::sample_buffer_protection},
+        {"peek_consume_allocations", audipi::tests::peek_consume_allocations},
+        {"player_tick_allocations", audipi::tests::player_tick_allocations},
+        {"read_error_handling", audipi::tests::read_error_handling},
+        {"c2_error_handling", audipi::tests::c2_error_handling},
+        {"scsi_c2_fallback", audipi::tests::scsi_c2_fallback},
+        {"persistent_cache_cap", audipi::tests::persistent_cache_cap},
+        {"gapless_playback", audipi::tests::gapless_playback},
+        {"trace_rings", audipi::tests::trace_rings},
+        {"track_reader_idle", audipi::tests::track_reader_idle},
+        {"speed_governor", audipi::tests::speed_governor},
+        {"secure_read", audipi::tests::secure_read},
+        {"audio_device_mmap", audipi::tests::audio_device_mmap},
+        {"playback_clock", audipi::tests::playback_clock},
+        {"file_sinks", audipi::tests::file_sinks},
+        {"seek_accuracy", audipi::tests::seek_accuracy},
+    };
+}
+
+void *operator new(const size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+size_t audipi::tests::allocation_count() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+bool audipi::tests::check(const bool condition, const char *what, const std::source_location location) {
+    if (!condition) {
+        failures.fetch_add(1, std::memory_order_relaxed);
+        printf("FAILED %s:%u: %s\n", location.file_name(), location.line(), what);
+    }
+    return condition;
+}
+
+// runs the test named on the command line, or all of them
+int main(const int argc, char *argv[]) {
+    bool found = false;
+    for (const auto &[name, run]: TEST_CASES) {
+        if (argc > 1 && std::strcmp(argv[1], name) != 0) {
+            continue;
+        }
+        found = true;
+        const size_t failures_before = failures.load();
+        run();
+        printf("%-32s %s\n", name, failures.load() == failures_before ? "ok" : "FAILED");
+    }
+
+    if (!found) {
+        printf("no test named %s\n", argv[1]);
+        return 1;
+    }
+    return failures.load() == 0 ? 0 : 1;
+}
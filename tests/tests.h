@@ -0,0 +1,114 @@
+#ifndef TESTS_H
+#define TESTS_H
+
+#include <cstdio>
+#include <source_location>
+
+namespace audipi::tests {
+    /**
+    * @brief Number of heap allocations made by the process so far.
+    */
+    size_t allocation_count();
+
+    /**
+    * @brief Records a failure, with where it happened, unless condition holds. Returns condition.
+    */
+    bool check(bool condition, const char *what, std::source_location location = std::source_location::current());
+
+    /**
+    * @brief Producer and consumer threads hammering a small SpscQueue: every item arrives once, in order.
+    */
+    void spsc_queue();
+
+    /**
+    * @brief The disc cache keeps the windows of the playing track and of the one pre-rolled after it at the same time,
+    * and lets a window go once its track releases it.
+    */
+    void sample_buffer_protection();
+
+    /**
+    * @brief Steady-state playback from the track queue allocates nothing: peek/consume with the reader feeding the
+    * queue, then the whole Player::tick() path into a NullSink.
+    */
+    void peek_consume_allocations();
+
+    void player_tick_allocations();
+
+    /**
+    * @brief A track read from a drive that fails: a frame that fails a few times is retried, one that never reads
+    * is concealed, and a pulled disc stops playback with the error.
+    */
+    void read_error_handling();
+
+    /**
+    * @brief A track read from a drive returning a frame it flags with C2 errors: read again while there is time,
+    * otherwise only the flagged samples are concealed, in fast and secure read modes alike.
+    */
+    void c2_error_handling();
+
+    /**
+    * @brief ScsiCdRom only stops asking for C2 errors when the drive refuses the field on the first read with them.
+    */
+    void scsi_c2_fallback();
+
+    /**
+    * @brief The persistent cache directory stays under its cap while a disc is being stored, evicting the discs
+    * played before it as it grows.
+    */
+    void persistent_cache_cap();
+
+    /**
+    * @brief A disc played through the Player into a sink checking every sample: consecutive tracks, one of them
+    * shorter than a track's queue, reach the sink as one unbroken run, after which the player stops by itself.
+    */
+    void gapless_playback();
+
+    /**
+    * @brief Threads get a trace ring only once they record an event while tracing is on, and exports read the rings
+    * while their threads keep writing.
+    */
+    void trace_rings();
+
+    /**
+    * @brief A reader with nothing left to read or prefetch sleeps until it is notified, instead of polling its track.
+    */
+    void track_reader_idle();
+
+    /**
+    * @brief The speed governor bursts to the fastest speed when playback is about to run dry, steps down a notch after
+    * the read-ahead stayed full for a while, and gives up only on errors saying the drive cannot select speeds.
+    */
+    void speed_governor();
+
+    /**
+    * @brief matching_samples() agrees with a sample by sample comparison at any length and alignment, and secure
+    * reads from a drive that misplaces reads and flips bits get every sample right.
+    */
+    void secure_read();
+
+    /**
+    * @brief Samples played into ALSA's file plugin over the null device come out intact, written through the mmap
+    * ring buffer when asked for, and with snd_pcm_writei otherwise. Skipped where ALSA cannot open the plugin.
+    */
+    void audio_device_mmap();
+
+    /**
+    * @brief The playback clock advances with wall time from its anchor, stops where the device runs out of samples,
+    * and stands still while paused.
+    */
+    void playback_clock();
+
+    /**
+    * @brief The pcm: and wav: sinks write the samples as given, the latter behind a header whose sizes are filled in
+    * on close; make_audio_sink() rejects specs it cannot make sense of.
+    */
+    void file_sinks();
+
+    /**
+    * @brief The first sample played after Player::seek() or seek_relative() is the one asked for, whether the target
+    * is cached or read from the drive by the seek.
+    */
+    void seek_accuracy();
+}
+
+#endif //TESTS_H
@@ -0,0 +1,52 @@
+#include <atomic>
+#include <thread>
+
+#include "tests.h"
+#include "../audipi/Trace.h"
+
+// more than a ring holds, so that the writer wraps around while an export reads
+constexpr size_t TRACED_EVENTS = 100000;
+
+namespace audipi::tests {
+    void trace_rings() {
+        // tracing off: naming a thread and running spans costs no allocation and leaves nothing to export
+        size_t quiet_allocations = 0;
+        std::thread([&quiet_allocations] {
+            const size_t allocations_before = allocation_count();
+            trace::set_thread_name("quiet thread");
+            for (size_t i = 0; i < 100; ++i) {
+                trace::Span span("quiet span");
+                trace::instant("quiet instant");
+            }
+            quiet_allocations = allocation_count() - allocations_before;
+        }).join();
+        check(quiet_allocations == 0, "tracing off: a named thread allocates no ring");
+        check(trace::export_chrome_json().find("quiet") == std::string::npos,
+              "tracing off: a thread that never traced is not exported");
+
+        // tracing on: the writer never waits on exports running at the same time
+        trace::set_enabled(true);
+        std::atomic<bool> done{false};
+        std::thread writer([&done] {
+            trace::set_thread_name("traced thread");
+            for (size_t i = 0; i < TRACED_EVENTS; ++i) {
+                trace::instant("traced instant", "i", i);
+            }
+            done.store(true, std::memory_order_release);
+        });
+        size_t exports = 0;
+        while (!done.load(std::memory_order_acquire)) {
+            check(trace::export_chrome_json().ends_with("]}\n"), "tracing on: an export during writes is complete");
+            ++exports;
+        }
+        writer.join();
+        trace::set_enabled(false);
+
+        const std::string json = trace::export_chrome_json();
+        check(json.find("traced thread") != std::string::npos, "tracing on: the ring takes the name set before it");
+        check(json.find(R"("i":)" + std::to_string(TRACED_EVENTS - 1) + "}") != std::string::npos,
+              "tracing on: the last event is exported");
+        check(json.find(R"("i":0})") == std::string::npos, "tracing on: overwritten events are not exported");
+        check(exports > 0, "tracing on: exports ran alongside the writer");
+    }
+}
@@ -0,0 +1,76 @@
+#include <atomic>
+#include <thread>
+
+#include "tests.h"
+#include "../audipi/TrackReader.h"
+
+constexpr auto SETTLE_TIME = std::chrono::milliseconds(50);
+constexpr auto IDLE_TIME = std::chrono::milliseconds(300);
+
+namespace {
+    /**
+    * @brief Track that is always fully read ahead, counting how often the reader looks at it.
+    */
+    class ReadyTrack final : public audipi::PlayerTrack {
+        std::atomic<size_t> read_aheads{0};
+
+    public:
+        void reset() override {
+        }
+
+        [[nodiscard]] std::expected<void, int> seek(const audipi::msfs_location &) override {
+            return {};
+        }
+
+        [[nodiscard]] std::string get_track_name() const override {
+            return "ready";
+        }
+
+        [[nodiscard]] std::expected<std::span<const audipi::sample_data>, int> peek_samples() override {
+            return {};
+        }
+
+        void consume_samples(size_t) override {
+        }
+
+        [[nodiscard]] std::expected<bool, int> read_ahead(size_t) override {
+            read_aheads.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        [[nodiscard]] bool is_finished() const override {
+            return false;
+        }
+
+        [[nodiscard]] audipi::msfs_location get_current_location() const override {
+            return {0, 0, 0, 0};
+        }
+
+        [[nodiscard]] size_t get_read_aheads() const {
+            return read_aheads.load(std::memory_order_relaxed);
+        }
+    };
+}
+
+namespace audipi::tests {
+    void track_reader_idle() {
+        ReadyTrack track;
+        TrackReader reader(5 * 75);
+        reader.set_track(&track);
+        std::this_thread::sleep_for(SETTLE_TIME);
+
+        const size_t settled = track.get_read_aheads();
+        std::this_thread::sleep_for(IDLE_TIME);
+        check(settled > 0 && track.get_read_aheads() == settled,
+              "a reader with nothing left to read sleeps until it is notified");
+
+        reader.notify();
+        const auto deadline = std::chrono::steady_clock::now() + IDLE_TIME;
+        while (track.get_read_aheads() == settled && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+        check(track.get_read_aheads() > settled, "a notification wakes the idle reader up");
+
+        reader.set_track(nullptr);
+    }
+}